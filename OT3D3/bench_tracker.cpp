@@ -0,0 +1,560 @@
+#include <map>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+
+#include <QGuiApplication>
+
+#include <benchmark/benchmark.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "view.h"
+#include "model.h"
+#include "object3d.h"
+#include "histogram.h"
+#include "search_line.h"
+#include "relocalizer.h"
+#include "tracker_slc.h"
+#include "tclc_histograms.h"
+#include "global_params.h"
+#include "transformations.h"
+#include "point_projector.h"
+#include "synthetic_sequence.h"
+#include "signed_distance_transform2d.h"
+
+// Microbenchmarks of the tracker kernels on synthetic data. The object is an icosphere
+// whose subdivision level controls the number of vertices, i.e. tclc-histograms, and
+// the frame size is varied through the pyramid levels of a 1280x960 view.
+
+static const int kWidth = 1280;
+static const int kHeight = 960;
+static const float kRadius = 80.0f;
+static const float kDistance = 600.0f;
+
+/**
+ *  Exposes the protected kernels of the SLC tracker to the benchmarks.
+ */
+class BenchSLCTracker : public SLCTracker {
+public:
+	BenchSLCTracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vector<Object3D*>& objects)
+		: SLCTracker(K, distCoeffs, objects) {}
+
+	using SLTracker::search_line;
+	using SLTracker::GetBundleProb;
+	using SLCTracker::FindMatchPoint;
+	using SLCTracker::ComputeJac;
+	using TrackerBase::hists;
+};
+
+static std::string WriteIcosphere(int subdivisions, bool ply = false) {
+	const float t = 1.61803f;
+	std::vector<cv::Vec3f> verts = {
+		{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+		{0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+		{t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}
+	};
+	std::vector<cv::Vec3i> faces = {
+		{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+		{1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+		{3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+		{4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
+	};
+
+	for (int s = 0; s < subdivisions; s++) {
+		std::map<std::pair<int, int>, int> midpoints;
+		auto midpoint = [&](int a, int b) {
+			std::pair<int, int> key(std::min(a, b), std::max(a, b));
+			auto it = midpoints.find(key);
+			if (it != midpoints.end())
+				return it->second;
+			verts.push_back((verts[a] + verts[b]) * 0.5f);
+			midpoints[key] = (int)verts.size() - 1;
+			return (int)verts.size() - 1;
+		};
+
+		std::vector<cv::Vec3i> subdivided;
+		for (auto& f : faces) {
+			int a = midpoint(f[0], f[1]);
+			int b = midpoint(f[1], f[2]);
+			int c = midpoint(f[2], f[0]);
+			subdivided.push_back(cv::Vec3i(f[0], a, c));
+			subdivided.push_back(cv::Vec3i(f[1], b, a));
+			subdivided.push_back(cv::Vec3i(f[2], c, b));
+			subdivided.push_back(cv::Vec3i(a, b, c));
+		}
+		faces.swap(subdivided);
+	}
+
+	std::string file = (std::filesystem::temp_directory_path() / ("ot3d3_bench_icosphere_" + std::to_string(subdivisions) + (ply ? ".ply" : ".obj"))).string();
+	if (ply) {
+		std::ofstream ofs(file, std::ios::binary);
+		ofs << "ply\nformat binary_little_endian 1.0\n"
+			<< "element vertex " << verts.size() << "\nproperty float x\nproperty float y\nproperty float z\n"
+			<< "element face " << faces.size() << "\nproperty list uchar int vertex_indices\nend_header\n";
+		for (auto& v : verts) {
+			cv::Vec3f p = v * (kRadius / (float)cv::norm(v));
+			ofs.write((const char*)p.val, sizeof(p.val));
+		}
+		for (auto& f : faces) {
+			unsigned char n = 3;
+			ofs.write((const char*)&n, 1);
+			ofs.write((const char*)f.val, sizeof(f.val));
+		}
+		return file;
+	}
+
+	std::ofstream ofs(file);
+	for (auto& v : verts) {
+		cv::Vec3f p = v * (kRadius / (float)cv::norm(v));
+		ofs << "v " << p[0] << ' ' << p[1] << ' ' << p[2] << '\n';
+	}
+	for (auto& f : faces)
+		ofs << "f " << f[0] + 1 << ' ' << f[1] + 1 << ' ' << f[2] + 1 << '\n';
+
+	return file;
+}
+
+static cv::Matx33f BenchK() {
+	return cv::Matx33f(900.0f, 0.0f, kWidth / 2.0f, 0.0f, 900.0f, kHeight / 2.0f, 0.0f, 0.0f, 1.0f);
+}
+
+static cv::Mat SyntheticFrame(int width, int height) {
+	cv::Mat frame(height, width, CV_8UC3);
+	cv::RNG rng(42);
+	rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar(0, 0, 0), cv::Scalar(120, 255, 120));
+	cv::circle(frame, cv::Point(width / 2, height / 2), int(kRadius * 900.0f / kDistance * width / kWidth), cv::Scalar(40, 40, 220), cv::FILLED);
+	return frame;
+}
+
+static cv::Mat SyntheticMask(int width, int height) {
+	cv::Mat mask(height, width, CV_8UC1, cv::Scalar(0));
+	cv::ellipse(mask, cv::Point(width / 2, height / 2), cv::Size(width / 5, height / 4), 30.0, 0.0, 360.0, cv::Scalar(255), cv::FILLED);
+	return mask;
+}
+
+/**
+ *  Projected contour vertices as they come out of the histogram center computation:
+ *  points in a 2 pixel band around an ellipse in arbitrary vertex order.
+ */
+static std::vector<cv::Point3i> SyntheticCenters(int num) {
+	cv::RNG rng(42);
+	std::vector<cv::Point3i> centers(num);
+	for (int i = 0; i < num; i++) {
+		float phi = rng.uniform(0.0f, (float)CV_2PI);
+		float r = 1.0f + rng.uniform(-2.0f, 2.0f) / 240.0f;
+		centers[i] = cv::Point3i(cvRound(kWidth / 2 + 320.0f * r * cos(phi)), cvRound(kHeight / 2 + 240.0f * r * sin(phi)), i);
+	}
+	return centers;
+}
+
+/**
+ *  One tracker per icosphere subdivision, initialized on the synthetic frame.
+ */
+struct TrackerFixture {
+	Object3D* object;
+	std::shared_ptr<BenchSLCTracker> tracker;
+	cv::Mat frame;
+
+	static TrackerFixture& Get(int subdivisions) {
+		static std::map<int, std::unique_ptr<TrackerFixture> > fixtures;
+		auto& fixture = fixtures[subdivisions];
+		if (!fixture)
+			fixture.reset(new TrackerFixture(subdivisions));
+		return *fixture;
+	}
+
+	TrackerFixture(int subdivisions) {
+		std::vector<float> distances = { kDistance };
+		cv::Matx44f pose = Transformations::translationMatrix(0.0f, 0.0f, kDistance);
+		object = new Object3D(WriteIcosphere(subdivisions), pose, 1.0f, 0.55f, distances);
+
+		std::vector<Object3D*> objects = { object };
+		tracker = std::make_shared<BenchSLCTracker>(BenchK(), cv::Matx14f(0, 0, 0, 0), objects);
+
+		frame = SyntheticFrame(kWidth, kHeight);
+		tracker->ToggleTracking(frame, 0, false);
+		tracker->PreProcess(frame);
+	}
+
+	// renders the object at a level and builds its search lines and bundle probabilities
+	void Prepare(int level, std::vector<cv::Mat>& pyramid, cv::Mat& mask, cv::Mat& depth) {
+		pyramid.clear();
+		for (int l = 0; l <= level; l++) {
+			cv::Mat img;
+			cv::resize(frame, img, cv::Size(kWidth >> l, kHeight >> l));
+			pyramid.push_back(img);
+		}
+
+		View* view = View::Instance();
+		view->setLevel(level);
+		view->RenderSilhouette(object, GL_FILL);
+		depth = view->DownloadFrame(View::DEPTH);
+		view->ConvertMask(depth, mask, 0);
+
+		tracker->search_line->FindSearchLine(mask, pyramid[level], 12, 2, true);
+		tracker->GetBundleProb(pyramid[level], 0);
+		tracker->FindMatchPoint(0.5f);
+	}
+};
+
+static void BM_TransformationsExp(benchmark::State& state) {
+	cv::Matx61f xi(0.01f, -0.02f, 0.005f, 0.5f, -0.3f, 1.2f);
+	for (auto _ : state) {
+		cv::Matx44f T = Transformations::exp(xi);
+		benchmark::DoNotOptimize(T);
+		xi(0) += 1e-6f;
+	}
+}
+BENCHMARK(BM_TransformationsExp);
+
+// Args: 0 = pure translation, 1 = small rotation, fails if exp(log(T)) != T
+static void BM_TransformationsLogExp(benchmark::State& state) {
+	cv::Matx61f motion(0.0f, 0.0f, 0.0f, 2.5f, -1.0f, 4.0f);
+	if (state.range(0) == 1) {
+		motion(0) = 0.02f;
+		motion(1) = -0.01f;
+		motion(2) = 0.015f;
+	}
+	cv::Matx44f T = Transformations::exp(motion);
+
+	float error = 0;
+	for (auto _ : state) {
+		cv::Matx44f T2 = Transformations::exp(Transformations::log(T));
+		error = (float)cv::norm(T2 - T, cv::NORM_INF);
+		benchmark::DoNotOptimize(T2);
+	}
+
+	state.counters["error"] = error;
+	if (error > 1e-4f)
+		state.SkipWithError("exp(log(T)) does not reproduce T");
+}
+BENCHMARK(BM_TransformationsLogExp)->Arg(0)->Arg(1);
+
+// Args: number of vertices
+static void BM_ProjectVisible(benchmark::State& state) {
+	int num = (int)state.range(0);
+	cv::RNG rng(7);
+	std::vector<cv::Vec3f> points(num);
+	for (int i = 0; i < num; i++) {
+		cv::Vec3f n(rng.gaussian(1.0), rng.gaussian(1.0), rng.gaussian(1.0));
+		points[i] = kRadius * n / cv::norm(n);
+	}
+	PointsSoA soa;
+	soa.assign(points);
+
+	cv::Mat depth(kHeight, kWidth, CV_32FC1, cv::Scalar(0.0f));
+	PointProjector projector(BenchK(), Transformations::translationMatrix(0, 0, kDistance));
+
+	std::vector<float> u(num), v(num);
+	std::vector<int> ids(num);
+	int count = 0;
+	for (auto _ : state) {
+		count = projector.ProjectVisible(soa, 0, num, depth, 10.0f, 10000.0f, 1.0f, u.data(), v.data(), ids.data());
+		benchmark::DoNotOptimize(count);
+	}
+	state.SetItemsProcessed(state.iterations() * num);
+	state.counters["visible"] = count;
+}
+BENCHMARK(BM_ProjectVisible)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_SDTComputeTransform(benchmark::State& state) {
+	int width = (int)state.range(0);
+	int height = width * 3 / 4;
+	cv::Mat mask = SyntheticMask(width, height);
+	cv::Mat sdt, xyPos;
+	SignedDistanceTransform2D transform(8.0f);
+	for (auto _ : state) {
+		transform.computeTransform(mask, sdt, xyPos, 0, 255);
+		benchmark::DoNotOptimize(sdt.data);
+	}
+	state.SetItemsProcessed(state.iterations() * width * height);
+}
+BENCHMARK(BM_SDTComputeTransform)->Arg(320)->Arg(640)->Arg(1280)->Unit(benchmark::kMicrosecond);
+
+static void BM_FindSearchLine(benchmark::State& state) {
+	int width = (int)state.range(0);
+	int height = width * 3 / 4;
+	cv::Mat mask = SyntheticMask(width, height);
+	cv::Mat frame = SyntheticFrame(width, height);
+	SearchLine search_line;
+	for (auto _ : state) {
+		search_line.FindSearchLine(mask, frame, 12, 2, true);
+		benchmark::DoNotOptimize(search_line.search_points.data());
+	}
+	state.counters["lines"] = (double)search_line.search_points.size();
+}
+BENCHMARK(BM_FindSearchLine)->Arg(320)->Arg(640)->Arg(1280)->Unit(benchmark::kMicrosecond);
+
+// Args: pyramid level, icosphere subdivisions
+static void BM_GetBundleProb(benchmark::State& state) {
+	int level = (int)state.range(0);
+	TrackerFixture& fixture = TrackerFixture::Get((int)state.range(1));
+	std::vector<cv::Mat> pyramid;
+	cv::Mat mask, depth;
+	fixture.Prepare(level, pyramid, mask, depth);
+	for (auto _ : state) {
+		fixture.tracker->GetBundleProb(pyramid[level], 0);
+		benchmark::DoNotOptimize(fixture.tracker->search_line->bundle_prob.data());
+	}
+	state.counters["histograms"] = (double)fixture.object->getTCLCHistograms()->getCentersAndIDs().size();
+}
+BENCHMARK(BM_GetBundleProb)->ArgsProduct({ {0, 1, 2}, {2, 3, 4} })->Unit(benchmark::kMicrosecond);
+
+static void BM_FindMatchPoint(benchmark::State& state) {
+	int level = (int)state.range(0);
+	TrackerFixture& fixture = TrackerFixture::Get(3);
+	std::vector<cv::Mat> pyramid;
+	cv::Mat mask, depth;
+	fixture.Prepare(level, pyramid, mask, depth);
+	for (auto _ : state) {
+		fixture.tracker->FindMatchPoint(0.5f);
+	}
+	state.counters["lines"] = (double)fixture.tracker->search_line->search_points.size();
+}
+BENCHMARK(BM_FindMatchPoint)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+static void BM_ComputeJac(benchmark::State& state) {
+	int level = (int)state.range(0);
+	TrackerFixture& fixture = TrackerFixture::Get(3);
+	std::vector<cv::Mat> pyramid;
+	cv::Mat mask, depth;
+	fixture.Prepare(level, pyramid, mask, depth);
+
+	View* view = View::Instance();
+	view->RenderSilhouette(fixture.object, GL_FILL, true);
+	cv::Mat depth_inv = view->DownloadFrame(View::DEPTH);
+
+	cv::Matx66f wJTJ;
+	cv::Matx61f JT;
+	for (auto _ : state) {
+		fixture.tracker->ComputeJac(fixture.object, -1, pyramid[level], mask, depth, depth, depth_inv, wJTJ, JT, 8.0f, 1.2f);
+		benchmark::DoNotOptimize(JT);
+	}
+}
+BENCHMARK(BM_ComputeJac)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// Args: icosphere subdivisions
+static void BM_TCLCHistogramsUpdate(benchmark::State& state) {
+	TrackerFixture& fixture = TrackerFixture::Get((int)state.range(0));
+
+	View* view = View::Instance();
+	view->setLevel(0);
+	view->RenderSilhouette(fixture.object, GL_FILL);
+	cv::Mat mask = view->DownloadFrame(View::MASK);
+	cv::Mat depth = view->DownloadFrame(View::DEPTH);
+
+	TCLCHistograms* histograms = fixture.object->getTCLCHistograms();
+	cv::Matx33f K = BenchK();
+	for (auto _ : state) {
+		histograms->update(fixture.frame, mask, depth, K, view->getZNear(), view->getZFar(), 0.1f, 0.2f);
+	}
+	state.counters["histograms"] = (double)histograms->getNumHistograms();
+	state.counters["centers"] = (double)histograms->getCentersAndIDs().size();
+}
+BENCHMARK(BM_TCLCHistogramsUpdate)->Arg(2)->Arg(3)->Arg(4)->Unit(benchmark::kMicrosecond);
+
+// Args: number of projected vertices
+static void BM_FilterCentersGreedy(benchmark::State& state) {
+	std::vector<cv::Point3i> candidates = SyntheticCenters((int)state.range(0));
+	std::vector<cv::Point3i> centers;
+	float offset = 0;
+	for (auto _ : state) {
+		centers = candidates;
+		offset = 10.0f;
+		TCLCHistograms::filterCentersGreedy(centers, 100, offset);
+	}
+	state.counters["centers"] = (double)centers.size();
+	state.counters["offset"] = offset;
+}
+BENCHMARK(BM_FilterCentersGreedy)->Arg(1000)->Arg(5000)->Arg(20000)->Arg(50000)->Unit(benchmark::kMicrosecond);
+
+// Args: number of projected vertices
+static void BM_FilterCentersPoissonDisk(benchmark::State& state) {
+	std::vector<cv::Point3i> candidates = SyntheticCenters((int)state.range(0));
+	std::vector<cv::Point3i> centers;
+	float offset = 0;
+	for (auto _ : state) {
+		centers = candidates;
+		offset = 10.0f;
+		TCLCHistograms::filterCentersPoissonDisk(centers, 100, offset);
+	}
+	state.counters["centers"] = (double)centers.size();
+	state.counters["offset"] = offset;
+}
+BENCHMARK(BM_FilterCentersPoissonDisk)->Arg(1000)->Arg(5000)->Arg(20000)->Arg(50000)->Unit(benchmark::kMicrosecond);
+
+// Args: icosphere subdivisions (7: 163842 vertices), silhouette candidates off/on
+static void BM_HistogramCenters(benchmark::State& state) {
+	TrackerFixture& fixture = TrackerFixture::Get((int)state.range(0));
+
+	View* view = View::Instance();
+	view->setLevel(0);
+	view->RenderSilhouette(fixture.object, GL_FILL);
+	cv::Mat mask = view->DownloadFrame(View::MASK);
+	cv::Mat depth = view->DownloadFrame(View::DEPTH);
+
+	TCLCHistograms* histograms = fixture.object->getTCLCHistograms();
+	histograms->setUseSilhouetteCandidates(state.range(1) != 0);
+
+	const int* ids = NULL;
+	int count = fixture.object->getNumSimpleVertices();
+	if (state.range(1) != 0)
+		fixture.object->getSilhouetteCandidates().GetCandidates(fixture.object->getPose(), ids, count);
+
+	cv::Matx33f K = BenchK();
+	for (auto _ : state) {
+		histograms->updateCentersAndIds(mask, depth, K, view->getZNear(), view->getZFar(), 0);
+	}
+	histograms->setUseSilhouetteCandidates(true);
+
+	state.counters["vertices"] = (double)fixture.object->getNumSimpleVertices();
+	state.counters["projected"] = (double)count;
+	state.counters["centers"] = (double)histograms->getCentersAndIDs().size();
+}
+BENCHMARK(BM_HistogramCenters)->ArgsProduct({ {4, 6, 7}, {0, 1} })->Unit(benchmark::kMicrosecond);
+
+/**
+ *  Tracks the icosphere along a synthetic trajectory from its ground-truth start pose and
+ *  returns the mean number of pose iterations per frame.
+ */
+static double MeanTrackingIterations(const std::string& file, const SyntheticSequence& sequence, int numFrames, bool prediction) {
+	// a separate model is rendered, so the ground truth never touches the tracked pose
+	Model model(file, sequence.GetPose(0), 1.0f);
+	model.initBuffers();
+	cv::Mat background = sequence.GenerateBackground();
+
+	std::vector<float> distances = { kDistance };
+	Object3D* object = new Object3D(file, sequence.GetPose(0), 1.0f, 0.55f, distances);
+	std::vector<Object3D*> objects = { object };
+
+	double iterations = 0.0;
+	{
+		BenchSLCTracker tracker(BenchK(), cv::Matx14f(0, 0, 0, 0), objects);
+		tracker.SetMotionPrediction(prediction);
+
+		cv::Mat frame = sequence.RenderFrame(&model, sequence.GetPose(0), background, 0);
+		tracker.ToggleTracking(frame, 0, false);
+		tracker.PreProcess(frame);
+
+		for (int fid = 1; fid < numFrames; fid++) {
+			frame = sequence.RenderFrame(&model, sequence.GetPose(fid), background, fid);
+			tracker.EstimatePoses(frame, false);
+			tracker.PostProcess(frame);
+			iterations += tracker.iter_count;
+		}
+	}
+	delete object;
+
+	return iterations / std::max(numFrames - 1, 1);
+}
+
+// Tracks the same synthetic trajectory with and without the constant-velocity motion
+// prediction, fails unless the prediction converges in fewer iterations on average
+static void BM_MotionPredictionIterations(benchmark::State& state) {
+	std::string file = WriteIcosphere(3);
+
+	SyntheticSequence::Settings settings;
+	settings.width = kWidth;
+	settings.height = kHeight;
+	settings.K = BenchK();
+	settings.distance = kDistance;
+	int numFrames = 60;
+
+	// the convergence test ends the iterations of a frame early, both runs need it
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+	int earlyTermination = gp->earlyTermination;
+	gp->earlyTermination = 1;
+
+	SyntheticSequence sequence(settings);
+	double withoutPrediction = 0.0, withPrediction = 0.0;
+	for (auto _ : state) {
+		withoutPrediction = MeanTrackingIterations(file, sequence, numFrames, false);
+		withPrediction = MeanTrackingIterations(file, sequence, numFrames, true);
+	}
+
+	gp->earlyTermination = earlyTermination;
+
+	state.counters["iterations_off"] = withoutPrediction;
+	state.counters["iterations_on"] = withPrediction;
+	if (withPrediction >= withoutPrediction)
+		state.SkipWithError("the motion prediction does not reduce the iterations per frame");
+}
+BENCHMARK(BM_MotionPredictionIterations)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// Args: icosphere subdivisions
+static void BM_RelocalizerDetect(benchmark::State& state) {
+	TrackerFixture& fixture = TrackerFixture::Get((int)state.range(0));
+	fixture.object->generateTemplates();
+
+	// the histograms are taken at the object's pose, the templates are searched everywhere
+	fixture.tracker->PreProcess(fixture.frame);
+
+	cv::Matx44f pose;
+	float score = 0;
+	for (auto _ : state) {
+		score = Relocalizer::Detect(fixture.object, fixture.frame, 1e6, pose);
+		benchmark::DoNotOptimize(pose);
+	}
+
+	// every base template is matched over the whole frame at the coarse level
+	double templates = (double)fixture.object->getTemplateViews().size();
+	state.counters["templates"] = templates;
+	state.counters["templates_per_ms"] = benchmark::Counter(templates * state.iterations() * 1e-3, benchmark::Counter::kIsRate);
+	state.counters["score"] = score;
+}
+BENCHMARK(BM_RelocalizerDetect)->Arg(2)->Arg(3)->Unit(benchmark::kMillisecond);
+
+// Args: icosphere subdivisions (9: 5.2M triangles), binary PLY through ASSIMP/tinyply
+static void BM_ImportPly(benchmark::State& state) {
+	std::string file = WriteIcosphere((int)state.range(0), true);
+
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+	int modelCache = gp->modelCache;
+	int fastPly = gp->fastPly;
+	gp->modelCache = 0;
+	gp->fastPly = (int)state.range(1);
+
+	// writes the silhouette candidate lists, so the iterations only load them
+	{
+		Model warmup(file, cv::Matx44f::eye(), 1.0f);
+	}
+
+	int triangles = 0;
+	for (auto _ : state) {
+		Model model(file, cv::Matx44f::eye(), 1.0f);
+		triangles = (int)model.getIndices().size() / 3;
+	}
+
+	gp->modelCache = modelCache;
+	gp->fastPly = fastPly;
+
+	state.counters["triangles"] = (double)triangles;
+}
+BENCHMARK(BM_ImportPly)->ArgsProduct({ {7, 9}, {0, 1} })->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+	// the kernels that render need the offscreen OpenGL context of the view
+	QCoreApplication::addLibraryPath("plugins");
+	QGuiApplication a(argc, argv);
+
+	// the fixtures scale with the icosphere subdivision, so use the mesh vertices as histogram centers
+	OT3D::GlobalParam::Instance()->surfaceSamples = 0;
+
+	View* view = View::Instance();
+	view->init(BenchK(), kWidth, kHeight, 10.0f, 10000.0f, 4);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	view->destroy();
+	return 0;
+}
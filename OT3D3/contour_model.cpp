@@ -0,0 +1,235 @@
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include "view.h"
+#include "object3d.h"
+#include "search_line.h"
+#include "contour_model.h"
+
+static const char kContourModelMagic[6] = { 'O', 'T', '3', 'D', 'C', 'M' };
+static const int kContourModelVersion = 2;
+
+static cv::Vec3f Normalized(const cv::Vec3f& v) {
+	float n = (float)cv::norm(v);
+	return n > 0.0f ? v / n : v;
+}
+
+// camera rotation looking along -direction, rows are the camera axes in model coordinates
+static cv::Matx33f LookAtRotation(const cv::Vec3f& direction) {
+	cv::Vec3f z = -direction;
+	cv::Vec3f up = fabs(direction[1]) < 0.9f ? cv::Vec3f(0, 1, 0) : cv::Vec3f(1, 0, 0);
+	cv::Vec3f x = Normalized(up.cross(z));
+	cv::Vec3f y = z.cross(x);
+
+	return cv::Matx33f(
+		x[0], x[1], x[2],
+		y[0], y[1], y[2],
+		z[0], z[1], z[2]);
+}
+
+ContourModel::ContourModel() {
+	center = cv::Vec3f(0, 0, 0);
+	subdivisions = 0;
+	numPoints = 0;
+}
+
+void ContourModel::Subdivide(std::vector<cv::Vec3f>& directions) {
+	// the edges of a geodesic sphere are the closest vertex pairs, their lengths vary
+	// by less than 20 percent while the diagonals of its triangles are sqrt(3) times longer
+	float min_angle = float(CV_PI);
+	for (int i = 0; i < directions.size(); i++)
+	for (int j = i + 1; j < directions.size(); j++) {
+		float angle = acos(std::min(1.0f, directions[i].dot(directions[j])));
+		min_angle = std::min(min_angle, angle);
+	}
+
+	float max_edge = 1.3f * min_angle;
+	int size = (int)directions.size();
+	for (int i = 0; i < size; i++)
+	for (int j = i + 1; j < size; j++) {
+		float angle = acos(std::min(1.0f, directions[i].dot(directions[j])));
+		if (angle < max_edge)
+			directions.push_back(Normalized(directions[i] + directions[j]));
+	}
+}
+
+bool ContourModel::Build(Object3D* object, int subdivisions, int numPoints) {
+	View* view = View::Instance();
+
+	views.clear();
+	this->subdivisions = subdivisions;
+	this->numPoints = numPoints;
+
+	std::vector<cv::Vec3f> directions;
+	for (auto& v : object->getSubdivIcosahedron())
+		directions.push_back(Normalized(v));
+	for (int s = 0; s < subdivisions; s++)
+		Subdivide(directions);
+
+	cv::Vec3f lbn = object->getLBN();
+	cv::Vec3f rtf = object->getRTF();
+	center = (lbn + rtf) * 0.5f;
+	float radius = 0.5f * (float)cv::norm(rtf - lbn);
+
+	int level = view->getLevel();
+	view->setLevel(0);
+
+	cv::Matx33f K = view->GetCalibrationMatrix().get_minor<3, 3>(0, 0);
+	float zn = view->getZNear();
+	float zf = view->getZFar();
+	int width = view->GetWidth();
+	int height = view->GetHeight();
+
+	// the silhouette covers about half of the shorter image side
+	float distance = std::max(4.0f * radius * K(0, 0) / std::min(width, height), zn + 2.0f * radius);
+
+	cv::Matx44f pose = object->getPose();
+
+	SearchLine search_line;
+	bool complete = true;
+	for (auto& direction : directions) {
+		cv::Matx33f R = LookAtRotation(direction);
+		cv::Vec3f t = -(R * (center + distance * direction));
+
+		object->setPose(cv::Matx44f(
+			R(0, 0), R(0, 1), R(0, 2), t[0],
+			R(1, 0), R(1, 1), R(1, 2), t[1],
+			R(2, 0), R(2, 1), R(2, 2), t[2],
+			0, 0, 0, 1));
+
+		view->RenderSilhouette(object, GL_FILL, false, 1.0f, 1.0f, 1.0f, true);
+		cv::Mat depth_map = view->DownloadFrame(View::DEPTH);
+		cv::Mat mask_map;
+		view->ConvertMask(depth_map, mask_map, 0);
+
+		search_line.FindSearchLine(mask_map, mask_map, 2, 1, false);
+
+		ContourView contour_view;
+		contour_view.direction = direction;
+
+		// evenly spaced along the contour
+		int n = (int)search_line.search_points.size();
+		int count = std::min(n, numPoints);
+		for (int i = 0; i < count; i++) {
+			int r = (int)((long long)i * n / count);
+			const std::vector<cv::Point>& sl = search_line.search_points[r];
+			cv::Point c = sl[sl.back().x];
+
+			float depth = 1.0f - depth_map.at<float>(c);
+			float D = 2.0f * zn * zf / (zf + zn - (2.0f * depth - 1.0f) * (zf - zn));
+			cv::Vec3f Xc(D * (c.x - K(0, 2)) / K(0, 0), D * (c.y - K(1, 2)) / K(1, 1), D);
+
+			cv::Point2f norm = search_line.norms[r];
+
+			contour_view.points.push_back(R.t() * (Xc - t));
+			contour_view.normals.push_back(R.t() * cv::Vec3f(norm.x, norm.y, 0.0f));
+		}
+
+		complete &= !contour_view.points.empty();
+		views.push_back(contour_view);
+	}
+
+	object->setPose(pose);
+	view->setLevel(level);
+
+	return complete;
+}
+
+int ContourModel::GetNearestView(const cv::Matx44f& T_cm) const {
+	cv::Matx33f R = T_cm.get_minor<3, 3>(0, 0);
+	cv::Vec3f t(T_cm(0, 3), T_cm(1, 3), T_cm(2, 3));
+
+	// camera center in model coordinates
+	cv::Vec3f direction = Normalized(-(R.t() * t) - center);
+
+	int nearest = -1;
+	float best = -2.0f;
+	for (int i = 0; i < views.size(); i++) {
+		float d = views[i].direction.dot(direction);
+		if (d > best) {
+			best = d;
+			nearest = i;
+		}
+	}
+
+	return nearest;
+}
+
+template <typename T>
+static void WriteRaw(std::ofstream& ofs, const T& value) {
+	ofs.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static bool ReadRaw(std::ifstream& ifs, T& value) {
+	return (bool)ifs.read((char*)&value, sizeof(T));
+}
+
+bool ContourModel::Save(const std::string& file, unsigned long long meshHash) const {
+	std::ofstream ofs(file, std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+
+	ofs.write(kContourModelMagic, sizeof(kContourModelMagic));
+	WriteRaw(ofs, kContourModelVersion);
+	WriteRaw(ofs, meshHash);
+	WriteRaw(ofs, subdivisions);
+	WriteRaw(ofs, numPoints);
+	WriteRaw(ofs, center);
+	WriteRaw(ofs, (int)views.size());
+
+	for (auto& contour_view : views) {
+		int count = (int)contour_view.points.size();
+		WriteRaw(ofs, contour_view.direction);
+		WriteRaw(ofs, count);
+		ofs.write((const char*)contour_view.points.data(), count * sizeof(cv::Vec3f));
+		ofs.write((const char*)contour_view.normals.data(), count * sizeof(cv::Vec3f));
+	}
+
+	return ofs.good();
+}
+
+bool ContourModel::Load(const std::string& file, unsigned long long meshHash) {
+	views.clear();
+
+	std::ifstream ifs(file, std::ios::binary);
+	if (!ifs.is_open())
+		return false;
+
+	char magic[sizeof(kContourModelMagic)];
+	int version = 0;
+	if (!ifs.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kContourModelMagic))
+		return false;
+	if (!ReadRaw(ifs, version) || version != kContourModelVersion)
+		return false;
+
+	// rendered from another mesh, also one with moved vertices
+	unsigned long long fileHash = 0;
+	if (!ReadRaw(ifs, fileHash) || fileHash != meshHash)
+		return false;
+
+	int numViews = 0;
+	if (!ReadRaw(ifs, subdivisions) || !ReadRaw(ifs, numPoints) || !ReadRaw(ifs, center) || !ReadRaw(ifs, numViews) || numViews < 0)
+		return false;
+
+	views.resize(numViews);
+	for (auto& contour_view : views) {
+		int count = 0;
+		if (!ReadRaw(ifs, contour_view.direction) || !ReadRaw(ifs, count) || count < 0 || count > numPoints) {
+			views.clear();
+			return false;
+		}
+
+		contour_view.points.resize(count);
+		contour_view.normals.resize(count);
+		ifs.read((char*)contour_view.points.data(), count * sizeof(cv::Vec3f));
+		ifs.read((char*)contour_view.normals.data(), count * sizeof(cv::Vec3f));
+		if (!ifs) {
+			views.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+class Object3D;
+
+/**
+ *  Sparse-viewpoint contour model of an object. For every viewpoint on a geodesic
+ *  sphere around the object it stores 3D contour points of the rendered silhouette
+ *  together with their outward contour normals, both in model coordinates. During
+ *  tracking the points of the viewpoint closest to the current pose are projected
+ *  instead of rasterizing the model.
+ */
+class ContourModel {
+public:
+	struct ContourView {
+		cv::Vec3f direction;	// unit vector from the object center towards the camera, model coordinates
+		std::vector<cv::Vec3f> points;
+		std::vector<cv::Vec3f> normals;
+	};
+
+	ContourModel();
+
+	/**
+	 *  Renders the object from all viewpoints and samples its contour. The viewpoints
+	 *  are the vertices of the sub-divided icosahedron of the object, further sub-divided
+	 *  the given number of times (0: 42, 1: 162, 2: 642 viewpoints).
+	 *
+	 *  @param  object The object, its buffers must have been initialized.
+	 *  @param  subdivisions The number of additional sub-divisions of the geodesic sphere.
+	 *  @param  numPoints The maximum number of contour points per viewpoint.
+	 *  @return True if contour points have been found for every viewpoint.
+	 */
+	bool Build(Object3D* object, int subdivisions, int numPoints);
+
+	/**
+	 *  Saves the contour model keyed by the hash of the object's mesh, see HashMesh().
+	 */
+	bool Save(const std::string& file, unsigned long long meshHash) const;
+
+	/**
+	 *  Loads the contour model if it has been built for the mesh with the given hash.
+	 */
+	bool Load(const std::string& file, unsigned long long meshHash);
+
+	/**
+	 *  Returns the index of the viewpoint closest to the direction of the camera.
+	 *
+	 *  @param  T_cm The pose of the object.
+	 *  @return The index of the closest viewpoint, -1 if the model is empty.
+	 */
+	int GetNearestView(const cv::Matx44f& T_cm) const;
+
+	const ContourView& GetView(int i) const { return views[i]; }
+	int GetNumViews() const { return (int)views.size(); }
+	bool IsEmpty() const { return views.empty(); }
+
+	int GetSubdivisions() const { return subdivisions; }
+	int GetNumPoints() const { return numPoints; }
+
+protected:
+	static void Subdivide(std::vector<cv::Vec3f>& directions);
+
+	std::vector<ContourView> views;
+	cv::Vec3f center;
+
+	int subdivisions;
+	int numPoints;
+};
@@ -0,0 +1,33 @@
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "cpu_features.h"
+
+static bool DetectAVX2() {
+#if defined(OT3D_AVX2) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// AVX with OSXSAVE, and the OS has to save the SSE and AVX registers
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(OT3D_AVX2)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+bool HasAVX2() {
+	static const bool avx2 = DetectAVX2();
+	return avx2;
+}
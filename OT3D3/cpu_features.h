@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ *  Runtime dispatch of the vectorized kernels. The projects are built for the x64
+ *  baseline, the AVX2 kernels are compiled for AVX2 one function at a time
+ *  (OT3D_TARGET_AVX2) and must only be called if HasAVX2() returns true, so the
+ *  binaries keep running on CPUs without AVX2.
+ */
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+// MSVC accepts the AVX2 intrinsics in any function without /arch:AVX2
+#define OT3D_AVX2 1
+#define OT3D_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define OT3D_AVX2 1
+#define OT3D_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef OT3D_AVX2
+#include <immintrin.h>
+#endif
+
+/**
+ *  True if the CPU supports AVX2 and the OS saves the AVX registers, checked on first use.
+ */
+bool HasAVX2();
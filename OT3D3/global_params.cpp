@@ -32,6 +32,15 @@ namespace OT3D
 		node >> field;
 	}
 
+	template <typename T>
+	void ReadOptionalValue(cv::FileStorage& fs, const std::string& idx, T& field) 
+	{
+		// keeps the default value when the key is missing
+		cv::FileNode node = fs[idx];
+		if (!node.empty())
+			node >> field;
+	}
+
 	template <typename T>
 	void ReadArray(cv::FileStorage& fs, const std::string& idx, std::vector<T>& field) 
 	{
@@ -67,6 +76,43 @@ namespace OT3D
 
 		ReadValue(fs, "color", color);
 
+		ReadOptionalValue(fs, "earlyTermination", earlyTermination);
+		ReadOptionalValue(fs, "convergenceSkipAll", convergenceSkipAll);
+		ReadOptionalValue(fs, "convergenceRotation", convergenceRotation);
+		ReadOptionalValue(fs, "convergenceTranslation", convergenceTranslation);
+		ReadOptionalValue(fs, "convergenceActiveLines", convergenceActiveLines);
+
+		ReadOptionalValue(fs, "lossDetection", lossDetection);
+		ReadOptionalValue(fs, "adaptiveIterations", adaptiveIterations);
+		ReadOptionalValue(fs, "confidentQuality", confidentQuality);
+		ReadOptionalValue(fs, "doubtfulQuality", doubtfulQuality);
+
+		ReadOptionalValue(fs, "motionPrediction", motionPrediction);
+		ReadOptionalValue(fs, "motionDamping", motionDamping);
+
+		ReadOptionalValue(fs, "modelCache", modelCache);
+		ReadOptionalValue(fs, "fastPly", fastPly);
+		ReadOptionalValue(fs, "surfaceSamples", surfaceSamples);
+
+		ReadOptionalValue(fs, "relocalization", relocalization);
+		ReadOptionalValue(fs, "templateCache", templateCache);
+		ReadOptionalValue(fs, "templateImages", templateImages);
+		ReadOptionalValue(fs, "relocalizationBudget", relocalizationBudget);
+		ReadOptionalValue(fs, "relocalizationCandidates", relocalizationCandidates);
+
+		ReadOptionalValue(fs, "threads", threads);
+		ReadOptionalValue(fs, "backgroundThreads", backgroundThreads);
+
+		ReadOptionalValue(fs, "traceEvents", traceEvents);
+
+		ReadOptionalValue(fs, "trackerMode", trackerMode);
+		ReadOptionalValue(fs, "contourSubdivisions", contourSubdivisions);
+		ReadOptionalValue(fs, "contourPoints", contourPoints);
+
+		ReadOptionalValue(fs, "contourReuse", contourReuse);
+		ReadOptionalValue(fs, "contourReuseRotation", contourReuseRotation);
+		ReadOptionalValue(fs, "contourReuseTranslation", contourReuseTranslation);
+
 	}
 
 } // namespace tk
\ No newline at end of file
@@ -22,6 +22,54 @@ namespace OT3D
 		float qualityThreshold = 0.55f;
 
 		std::string color;
+
+		// early termination of the pose iterations
+		int earlyTermination = 1;        // 0: always run all iterations, 1: stop converged objects
+		int convergenceSkipAll = 0;      // 0: skip the remaining iterations of a level, 1: skip all remaining levels
+		float convergenceRotation = 0.0005f;   // rotation step norm (rad)
+		float convergenceTranslation = 0.05f;  // translation step norm (model units)
+		float convergenceActiveLines = 0.02f;  // relative change of the active search line count
+
+		// tracking quality of the last iteration, 0.5: no better than chance, see qualityThreshold
+		int lossDetection = 0;           // 0: never mark objects as lost, 1: mark objects below their quality threshold as lost, always on with relocalization
+		int adaptiveIterations = 0;      // 0: fixed iterations per level, 1: scale them by the worst quality of the last frame
+		float confidentQuality = 0.8f;   // quality above which the iterations per level are halved
+		float doubtfulQuality = 0.65f;   // quality below which the iterations per level are doubled
+
+		// constant-velocity motion prediction
+		int motionPrediction = 0;        // 0: start each frame from the last pose, 1: extrapolate from the last two poses
+		float motionDamping = 1.0f;      // scale of the predicted twist, 0: no prediction, 1: full constant velocity
+
+		// tracker
+		int trackerMode = 0;             // 0: SLC, 1: sparse SLC on a precomputed contour model
+		int contourSubdivisions = 1;     // geodesic sphere of the contour model, 0: 42, 1: 162, 2: 642 viewpoints
+		int contourPoints = 200;         // maximum contour points per viewpoint
+
+		// contour reuse between iterations
+		int contourReuse = 0;            // 0: render the silhouette every iteration, 1: reproject the last rendered contour while the pose is close
+		float contourReuseRotation = 0.02f;    // rotation since the last render (rad)
+		float contourReuseTranslation = 1.0f;  // translation since the last render (model units)
+
+		// model loading
+		int modelCache = 1;              // 0: always import with ASSIMP, 1: load the binary <model>.cache while it is up to date
+		int fastPly = 1;                 // 0: import PLY with ASSIMP, 1: stream triangle PLY files with tinyply
+
+		// pose detection templates
+		int relocalization = 0;          // 0: no detection templates, 1: create the detection templates with the tracker
+		int templateCache = 1;           // 0: always render the templates, 1: map the binary <model>.templates while it is up to date
+		int templateImages = 1;          // 0: only the compressed pixel data used for matching, 1: also 16 bit SDTs and 8 bit Heaviside images, 2: also float images and masks for debugging
+		float relocalizationBudget = 100.0f;  // time per search after which no further parts of it are started (ms)
+		int relocalizationCandidates = 5;      // best base templates refined with their neighbors at the finer level
+
+		// histogram-center vertices without a simple model
+		int surfaceSamples = 1000;       // uniform surface samples cached in <model>.samples, 0: use the mesh vertices
+
+		// kernel thread pool
+		int threads = 0;                 // threads of the Parallel_For_* kernels including the calling one, 0: all hardware threads
+		int backgroundThreads = 1;       // pool workers that background loops such as the relocalization may occupy at once
+
+		// stage timer
+		int traceEvents = 0;             // 0: per-frame stage totals only, 1: also record every timed event for trace export
 		
 	protected:
 		GlobalParam();
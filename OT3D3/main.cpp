@@ -16,6 +16,7 @@
 #include "viewer.h"
 #include "tracker.h"
 #include "object3d.h"
+#include "relocalizer.h"
 #include "global_params.h"
 
 
@@ -70,6 +71,8 @@ int main(int argc, char* argv[])
 	std::vector<Object3D*> objects;
 
 	filename = gp->projDir + "/Resources/Model.obj";
+	if (!IsFileExist(filename) && IsFileExist(gp->projDir + "/Resources/Model.ply"))
+		filename = gp->projDir + "/Resources/Model.ply";
 	objects.push_back(new Object3D(filename, initial_pose, gp->scale, gp->qualityThreshold, distances));
 
 
@@ -86,6 +89,11 @@ int main(int argc, char* argv[])
 
 	std::shared_ptr<Tracker> tracker_ptr(Tracker::GetTracker(K, D, objects));
 
+	// searches the templates of lost objects in the background
+	std::shared_ptr<Relocalizer> relocalizer_ptr;
+	if (gp->relocalization != 0)
+		relocalizer_ptr = std::make_shared<Relocalizer>(objects);
+
 	//////////////////////////////////////////////// Open video ////////////////////////////////////////////////
 
 	// Open video
@@ -129,12 +137,18 @@ int main(int argc, char* argv[])
 		tracker_ptr->EstimatePoses(frame, false);
 		tracker_ptr->PostProcess(frame);
 
+		if (relocalizer_ptr)
+			relocalizer_ptr->Update(frame);
+
 		auto e2 = cv::getTickCount();
 		auto time = 1000 * ((e2 - e1) / cv::getTickFrequency());
 
 		cv::Mat result = viewer_ptr->DrawOverlay(frame, polygonMode, gp->color);
 
 		cv::putText(result, cv::format("Time: %3.2f ms", time), cv::Point(5, 35), cv::FONT_HERSHEY_DUPLEX, 1.0, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+		cv::putText(result, cv::format("Iterations: %d", tracker_ptr->iter_count), cv::Point(5, 105), cv::FONT_HERSHEY_DUPLEX, 1.0, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+		if (objects[0]->getTrackingQuality() >= 0.0f)
+			cv::putText(result, cv::format("Quality: %.2f", objects[0]->getTrackingQuality()), cv::Point(5, 140), cv::FONT_HERSHEY_DUPLEX, 1.0, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
 
 		if (objects[0]->isTrackingLost())
 			cv::putText(result, "Tracking is lost: relocation...", cv::Point(5, 70), cv::FONT_HERSHEY_DUPLEX, 1.0, cv::Scalar(0, 0, 255), 1, cv::LINE_AA);
@@ -175,10 +189,18 @@ int main(int argc, char* argv[])
 		if (key == 32) // Space: start/stop tracking
 		{
 			timeout = 1;
+			if (relocalizer_ptr)
+				relocalizer_ptr->Cancel(0);
 			tracker_ptr->ToggleTracking(frame, 0, false);
 			tracker_ptr->EstimatePoses(frame, false);
 		}
 
+		if (key == (int)'m' || key == (int)'M') // Enable/disable the constant-velocity motion prediction
+		{
+			tracker_ptr->SetMotionPrediction(!tracker_ptr->GetMotionPrediction());
+			spdlog::info("Motion prediction: {}", tracker_ptr->GetMotionPrediction() ? "on" : "off");
+		}
+
 		if (27 == key)
 			break;
 
@@ -187,10 +209,14 @@ int main(int argc, char* argv[])
 			for (int i = 0; i < objects.size(); ++i) 
 			{
 				objects[i]->setPose(initial_pose);
+				objects[i]->setPrePose(initial_pose);
 			}
 		}
 	}
 
+	// cancels and joins a running search, which reads the objects and the templates
+	relocalizer_ptr.reset();
+
 	// Closes all the frames
 	cv::destroyAllWindows();
 	// When everything done, release the video capture
@@ -0,0 +1,267 @@
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <algorithm>
+#include <filesystem>
+
+#include <QGuiApplication>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "view.h"
+#include "utils.h"
+#include "tracker.h"
+#include "object3d.h"
+#include "pose_writer.h"
+#include "global_params.h"
+
+namespace fs = std::filesystem;
+
+/**
+ *  Reads the frames of either a video file or a directory of images, the
+ *  latter in lexicographic file name order.
+ */
+class FrameSource {
+public:
+	bool Open(const std::string& input) {
+		images.clear();
+		next = 0;
+
+		if (fs::is_directory(input)) {
+			std::vector<cv::String> files;
+			cv::glob(input + "/*", files, false);
+			for (auto& file : files) {
+				std::string ext = fs::path(file).extension().string();
+				std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+				if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tif" || ext == ".tiff")
+					images.push_back(file);
+			}
+			std::sort(images.begin(), images.end());
+			return !images.empty();
+		}
+
+		return cap.open(input);
+	}
+
+	bool Read(cv::Mat& frame) {
+		if (cap.isOpened()) {
+			cap >> frame;
+		} else if (next < images.size()) {
+			frame = cv::imread(images[next++], cv::IMREAD_COLOR);
+		} else {
+			frame.release();
+		}
+		return !frame.empty();
+	}
+
+	void Close() {
+		cap.release();
+		images.clear();
+	}
+
+protected:
+	cv::VideoCapture cap;
+	std::vector<std::string> images;
+	size_t next = 0;
+};
+
+static double Percentile(std::vector<double> values, double p) {
+	if (values.empty())
+		return 0.0;
+
+	std::sort(values.begin(), values.end());
+	double rank = p * (values.size() - 1);
+	size_t lo = (size_t)floor(rank);
+	size_t hi = std::min(lo + 1, values.size() - 1);
+	return values[lo] + (values[hi] - values[lo]) * (rank - lo);
+}
+
+static double ElapsedMs(int64 t0, int64 t1) {
+	return 1000.0 * (t1 - t0) / cv::getTickFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 4) {
+		std::cerr << "usage: " << argv[0] << " <config.yml> <output_dir> <video|image_dir> [<video|image_dir> ...]" << std::endl;
+		return -1;
+	}
+
+	// the offscreen OpenGL context of the view still needs a Qt application, but no window is ever created
+	QCoreApplication::addLibraryPath("plugins");
+	QGuiApplication a(argc, argv);
+
+	spdlog::set_level(spdlog::level::info);
+	spdlog::info("OT3D-3.0.0 batch");
+
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+	gp->ParseConfig(argv[1]);
+
+	std::string out_dir = argv[2];
+	std::error_code ec;
+	fs::create_directories(out_dir, ec);
+	if (!fs::is_directory(out_dir)) {
+		spdlog::critical("Cannot create output directory {}", out_dir);
+		return -1;
+	}
+
+	//////////////////////////////////////////////// Read camera parameters and initial pose ////////////////////////////////////////////////
+
+	cv::Matx33f K;
+	cv::Matx14f D;
+	int image_width, image_height;
+	cv::Mat camera_matrix, distortion_coefficients;
+
+	std::string filename = gp->projDir + "/camera_calibration.yaml";
+	if (!readCameraParameters(filename, image_width, image_height, camera_matrix, distortion_coefficients, K, D)) {
+		spdlog::critical("Invalid camera file");
+		return -1;
+	}
+
+	cv::Matx44f initial_pose;
+	filename = gp->projDir + "/Resources/initial_pose.yaml";
+	if (!readInitialPose(filename, initial_pose)) {
+		spdlog::critical("Invalid initial pose");
+		return -1;
+	}
+
+	//////////////////////////////////////////////// Load 3D objects, view and tracker ////////////////////////////////////////////////
+
+	std::vector<float> distances = { 200.0f, 400.0f, 600.0f };
+
+	std::vector<Object3D*> objects;
+	filename = gp->projDir + "/Resources/Model.obj";
+	if (!IsFileExist(filename) && IsFileExist(gp->projDir + "/Resources/Model.ply"))
+		filename = gp->projDir + "/Resources/Model.ply";
+	objects.push_back(new Object3D(filename, initial_pose, gp->scale, gp->qualityThreshold, distances));
+
+	View* view = View::Instance();
+	view->init(K, image_width, image_height, gp->zn, gp->zf, 4);
+
+	std::shared_ptr<Tracker> tracker_ptr(Tracker::GetTracker(K, D, objects));
+
+	//////////////////////////////////////////////// Run all inputs ////////////////////////////////////////////////
+
+	// frame level stages followed by the fine-grained stages of the tracker
+	std::vector<std::string> stages = { "track", "update", "total" };
+	for (int s = 0; s < StageTimer::NUM_STAGES; s++)
+		stages.push_back(StageTimer::StageName(s));
+	std::vector<std::vector<double> > stage_times(stages.size());
+	std::vector<double> iterations;
+
+	int total_frames = 0;
+	double total_ms = 0.0;
+	int failed = 0;
+
+	for (int i = 3; i < argc; i++) {
+		std::string input = argv[i];
+
+		FrameSource source;
+		cv::Mat frame;
+		if (!source.Open(input) || !source.Read(frame)) {
+			spdlog::error("Cannot read {}", input);
+			failed++;
+			continue;
+		}
+
+		std::string stem = fs::path(input).filename().string();
+		if (stem.empty())
+			stem = fs::path(input).parent_path().filename().string();
+
+		PoseWriter pose_writer(out_dir + "/" + stem + "_poses.txt", input, (int)objects.size());
+		TimingWriter timing_writer(out_dir + "/" + stem + "_timing.csv", { "track_ms", "update_ms", "total_ms", "iterations" });
+		if (!pose_writer.IsOpen() || !timing_writer.IsOpen()) {
+			spdlog::error("Cannot write results of {} to {}", input, out_dir);
+			failed++;
+			continue;
+		}
+
+		spdlog::info("Processing {}", input);
+
+		// start every input from the initial pose with fresh histograms and timings, the first
+		// frame only initializes the histograms, so the tracked frames start at 1 like the poses
+		tracker_ptr->reset(1);
+		StageTimer& stage_timer = tracker_ptr->GetStageTimer();
+		stage_timer.SetMaxFrames(0);	// the whole input is exported
+		for (int oid = 0; oid < objects.size(); oid++)
+			tracker_ptr->ToggleTracking(frame, oid, false);
+		tracker_ptr->PreProcess(frame);
+
+		int fid = 0;
+		for (int oid = 0; oid < objects.size(); oid++)
+			pose_writer.Record(objects[oid]->getPose(), fid);
+
+		int input_frames = 0;
+		double input_ms = 0.0;
+		while (source.Read(frame)) {
+			fid++;
+
+			int64 t0 = cv::getTickCount();
+			tracker_ptr->EstimatePoses(frame, false);
+			int64 t1 = cv::getTickCount();
+			tracker_ptr->PostProcess(frame);
+			int64 t2 = cv::getTickCount();
+
+			std::vector<double> times = { ElapsedMs(t0, t1), ElapsedMs(t1, t2), ElapsedMs(t0, t2) };
+			for (size_t s = 0; s < times.size(); s++)
+				stage_times[s].push_back(times[s]);
+			for (int s = 0; s < StageTimer::NUM_STAGES; s++)
+				stage_times[times.size() + s].push_back(stage_timer.FrameTime(StageTimer::Stage(s)) / 1000.0);
+			iterations.push_back(tracker_ptr->iter_count);
+
+			times.push_back(tracker_ptr->iter_count);
+			timing_writer.Record(fid, times);
+
+			for (int oid = 0; oid < objects.size(); oid++)
+				pose_writer.Record(objects[oid]->getPose(), fid);
+
+			input_frames++;
+			input_ms += ElapsedMs(t0, t2);
+		}
+
+		source.Close();
+
+		std::string prefix = out_dir + "/" + stem;
+		if (!stage_timer.ExportCSV(prefix + "_stages.csv") || !stage_timer.ExportJSONLines(prefix + "_stages.jsonl"))
+			spdlog::error("Cannot write the stage timings of {}", input);
+		if (stage_timer.GetRecordEvents() && !stage_timer.ExportChromeTrace(prefix + "_trace.json"))
+			spdlog::error("Cannot write the trace of {}", input);
+
+		spdlog::info("{}: {} frames, {:.1f} fps", stem, input_frames, input_ms > 0.0 ? 1000.0 * input_frames / input_ms : 0.0);
+
+		total_frames += input_frames;
+		total_ms += input_ms;
+	}
+
+	//////////////////////////////////////////////// Throughput summary ////////////////////////////////////////////////
+
+	std::cout << std::endl;
+	std::cout << "frames: " << total_frames << ", time: " << total_ms / 1000.0 << " s, fps: "
+		<< (total_ms > 0.0 ? 1000.0 * total_frames / total_ms : 0.0) << std::endl;
+
+	std::cout << cv::format("%-12s %10s %10s %10s %10s %10s", "stage [ms]", "mean", "p50", "p90", "p99", "max") << std::endl;
+	for (size_t s = 0; s < stages.size(); s++) {
+		const std::vector<double>& t = stage_times[s];
+		double mean = t.empty() ? 0.0 : std::accumulate(t.begin(), t.end(), 0.0) / t.size();
+		std::cout << cv::format("%-12s %10.3f %10.3f %10.3f %10.3f %10.3f", stages[s].c_str(), mean,
+			Percentile(t, 0.5), Percentile(t, 0.9), Percentile(t, 0.99), Percentile(t, 1.0)) << std::endl;
+	}
+	std::cout << cv::format("%-12s %10s %10.1f %10.1f %10.1f %10.1f", "iterations", "",
+		Percentile(iterations, 0.5), Percentile(iterations, 0.9), Percentile(iterations, 0.99), Percentile(iterations, 1.0)) << std::endl;
+
+	tracker_ptr.reset();
+	View::Instance()->destroy();
+
+	for (int i = 0; i < objects.size(); i++)
+		delete objects[i];
+	objects.clear();
+
+	return failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,51 @@
+#include <string>
+#include <iostream>
+
+#include <QGuiApplication>
+
+#include <spdlog/spdlog.h>
+
+#include "view.h"
+#include "model.h"
+#include "synthetic_sequence.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3) {
+		std::cerr << "usage: " << argv[0] << " <model.obj> <output_dir> [num_frames] [seed]" << std::endl;
+		return -1;
+	}
+
+	QCoreApplication::addLibraryPath("plugins");
+	QGuiApplication a(argc, argv);
+
+	spdlog::info("OT3D-3.0.0 synthetic sequence generator");
+
+	SyntheticSequence::Settings settings;
+	if (argc > 3)
+		settings.numFrames = std::stoi(argv[3]);
+	if (argc > 4)
+		settings.seed = (unsigned int)std::stoul(argv[4]);
+
+	std::string model_file = argv[1];
+	std::string out_dir = argv[2];
+
+	SyntheticSequence sequence(settings);
+
+	View* view = View::Instance();
+	view->init(settings.K, settings.width, settings.height, settings.zNear, settings.zFar, 4);
+
+	Model* model = new Model(model_file, sequence.GetPose(0), 1.0f);
+	model->initBuffers();
+
+	bool ok = sequence.Write(model, model_file, out_dir);
+	if (ok)
+		spdlog::info("Wrote {} frames with seed {} to {}", settings.numFrames, settings.seed, out_dir);
+	else
+		spdlog::critical("Cannot write the sequence to {}", out_dir);
+
+	delete model;
+	view->destroy();
+
+	return ok ? 0 : -1;
+}
@@ -0,0 +1,108 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : data(NULL), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL) {
+}
+
+bool MappedFile::Open(const std::string& file) {
+	Close();
+
+	fileHandle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		Close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		Close();
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data != NULL)
+		UnmapViewOfFile(data);
+	if (mappingHandle != NULL)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	data = NULL;
+	size = 0;
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : data(NULL), size(0), fd(-1) {
+}
+
+bool MappedFile::Open(const std::string& file) {
+	Close();
+
+	fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		Close();
+		return false;
+	}
+
+	void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) {
+		Close();
+		return false;
+	}
+
+	data = (const char*)p;
+	size = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data != NULL)
+		munmap((void*)data, size);
+	if (fd >= 0)
+		close(fd);
+
+	data = NULL;
+	size = 0;
+	fd = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/**
+ *  A read-only memory mapping of a whole file. The mapping is released with
+ *  Close() or when the object is destroyed.
+ */
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& file);
+	void Close();
+
+	bool IsOpen() const { return data != NULL; }
+
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+protected:
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fd;
+#endif
+};
@@ -1,13 +1,4 @@
-#include <limits>
-
-#include <assimp/scene.h>
-#include <assimp/mesh.h>
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-
-#include "utils.h"
 #include "model.h"
-#include "tclc_histograms.h"
 
 using namespace std;
 using namespace cv;
@@ -20,18 +11,21 @@ Model::Model(const string modelFilename, float tx, float ty, float tz, float alp
 	*Transformations::rotationMatrix(gamma, Vec3f(0, 0, 1))
 	*Matx44f::eye();
 
-	Init(modelFilename, Ti, scale);
+	Init(ModelAsset::Get(modelFilename), Ti, scale);
 }
 
 Model::Model(const std::string modelFilename, const cv::Matx44f& Ti, float scale) {
-	Init(modelFilename, Ti, scale);
+	Init(ModelAsset::Get(modelFilename), Ti, scale);
+}
+
+Model::Model(std::shared_ptr<ModelAsset> asset, const cv::Matx44f& Ti, float scale) {
+	Init(asset, Ti, scale);
 }
 
-void Model::Init(const std::string modelFilename, const cv::Matx44f& Ti, float scale) {
+void Model::Init(std::shared_ptr<ModelAsset> asset, const cv::Matx44f& Ti, float scale) {
 	m_id = 0;
     
 	initialized = false;
-	buffersInitialsed = false;
     
 	T_i = Ti;
 	T_cm = T_i;
@@ -39,55 +33,18 @@ void Model::Init(const std::string modelFilename, const cv::Matx44f& Ti, float s
 
 	scaling = scale;
     
-	T_n = Matx44f::eye();
-    
-	hasNormals = false;
+	this->asset = asset;
     
-	vertexBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
-	normalBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
-	indexBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
-    
-	loadModel(modelFilename);
+	T_n = Matx44f::eye();
 }
 
 Model::~Model()
 {
-    vertices.clear();
-    normals.clear();
-    
-    indices.clear();
-    offsets.clear();
-    
-    if(buffersInitialsed)
-    {
-        vertexBuffer.release();
-        vertexBuffer.destroy();
-        normalBuffer.release();
-        normalBuffer.destroy();
-        
-        indexBuffer.release();
-        indexBuffer.destroy();
-    }
 }
 
 void Model::initBuffers()
 {
-    vertexBuffer.create();
-    vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    vertexBuffer.bind();
-    vertexBuffer.allocate(vertices.data(), (int)vertices.size() * sizeof(Vec3f));
-    
-    normalBuffer.create();
-    normalBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    normalBuffer.bind();
-    normalBuffer.allocate(normals.data(), (int)normals.size() * sizeof(Vec3f));
-    
-    indexBuffer.create();
-    indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    indexBuffer.bind();
-    indexBuffer.allocate(indices.data(), (int)indices.size() * sizeof(int));
-    
-    buffersInitialsed = true;
+    asset->initBuffers();
 }
 
 
@@ -105,25 +62,7 @@ bool Model::isInitialized()
 
 void Model::draw(QOpenGLShaderProgram *program, GLint primitives)
 {
-    vertexBuffer.bind();
-    program->enableAttributeArray("aPosition");
-    program->setAttributeBuffer("aPosition", GL_FLOAT, 0, 3, sizeof(Vec3f));
-    
-    normalBuffer.bind();
-    program->enableAttributeArray("aNormal");
-    program->setAttributeBuffer("aNormal", GL_FLOAT, 0, 3, sizeof(Vec3f));
-    
-    program->enableAttributeArray("aColor");
-    program->setAttributeBuffer("aColor", GL_UNSIGNED_BYTE, 0, 3, sizeof(Vec3b));
-    
-    indexBuffer.bind();
-    
-    for (uint i = 0; i < offsets.size() - 1; i++) {
-        GLuint size = offsets.at(i + 1) - offsets.at(i);
-        GLuint offset = offsets.at(i);
-        
-        glDrawElements(primitives, size, GL_UNSIGNED_INT, (GLvoid*)(offset*sizeof(GLuint)));
-    }
+    asset->draw(primitives);
 }
 
 
@@ -160,12 +99,12 @@ Matx44f Model::getNormalization()
 
 Vec3f Model::getLBN()
 {
-    return lbn;
+    return asset->getLBN();
 }
 
 Vec3f Model::getRTF()
 {
-    return rtf;
+    return asset->getRTF();
 }
 
 float Model::getScaling() 
@@ -174,214 +113,73 @@ float Model::getScaling()
     return scaling;
 }
 
-
-vector<Vec3f> Model::getVertices()
+string Model::getModelFilename()
 {
-    return vertices;
+    return asset->getModelFilename();
 }
 
-vector<Vec3f> Model::getSimpleVertices()
+std::shared_ptr<ModelAsset> Model::getAsset()
 {
-    return svertices;
+    return asset;
 }
 
-int Model::getNumVertices()
+
+const vector<Vec3f>& Model::getVertices() const
 {
-    return (int)vertices.size();
+    return asset->getVertices();
 }
 
-int Model::getNumSimpleVertices()
+const vector<GLuint>& Model::getIndices() const
 {
-    return (int)svertices.size();
+    return asset->getIndices();
 }
 
-int Model::getModelID()
+const vector<Vec3f>& Model::getSimpleVertices()
 {
-    return m_id;
+    return asset->getSimpleVertices();
 }
 
-
-void Model::setModelID(int i)
+const PointsSoA& Model::getVerticesSoA()
 {
-    m_id = i;
+    return asset->getVerticesSoA();
 }
 
-
-void Model::reset()
+const PointsSoA& Model::getSimpleVerticesSoA()
 {
-    initialized = false;
-    
-    T_cm = T_i;
+    return asset->getSimpleVerticesSoA();
 }
 
-void IdenInsert(std::vector<aiVector3D>& verts, const aiVector3D& vert)
+const SilhouetteCandidates& Model::getSilhouetteCandidates()
 {
-    for (int i = 0; i < verts.size(); ++i) {
-        if (verts[i] == vert)
-            return;
-    }
-
-    verts.push_back(vert);
+    return asset->getSilhouetteCandidates();
 }
 
-void IdentAdd(std::vector<Vec3f>& vertices, aiVector3D* aiv, unsigned int num) {
-    vertices.clear();
-
-    std::vector<aiVector3D> setv;
-
-    for (int i = 0; i < num; ++i) {
-        IdenInsert(setv, aiv[i]);
-    }
+int Model::getNumVertices()
+{
+    return (int)asset->getVertices().size();
+}
 
-    for (auto vert : setv) {
-        vertices.push_back(Vec3f(vert.x, vert.y, vert.z));
-    }
+int Model::getNumSimpleVertices()
+{
+    return (int)asset->getSimpleVertices().size();
 }
 
-void Model::loadModel(const string modelFilename)
+int Model::getModelID()
 {
-    Assimp::Importer importer;
-    
-    const aiScene* scene = importer.ReadFile(modelFilename, aiProcessPreset_TargetRealtime_Fast);
-    
-    aiMesh *mesh = scene->mMeshes[0];
-    
-    hasNormals = mesh->HasNormals();
-    
-    float inf = numeric_limits<float>::infinity();
-    lbn = Vec3f(inf, inf, inf);
-    rtf = Vec3f(-inf, -inf, -inf);
-    
-    for(int i = 0; i < mesh->mNumFaces; i++)
-    {
-        aiFace f = mesh->mFaces[i];
-        
-        indices.push_back(f.mIndices[0]);
-        indices.push_back(f.mIndices[1]);
-        indices.push_back(f.mIndices[2]);
-    }
-    
-    for(int i = 0; i < mesh->mNumVertices; i++)
-    {
-        aiVector3D v = mesh->mVertices[i];
-        
-        Vec3f p(v.x, v.y, v.z);
-        
-        // compute the 3D bounding box of the model
-        if (p[0] < lbn[0]) lbn[0] = p[0];
-        if (p[1] < lbn[1]) lbn[1] = p[1];
-        if (p[2] < lbn[2]) lbn[2] = p[2];
-        if (p[0] > rtf[0]) rtf[0] = p[0];
-        if (p[1] > rtf[1]) rtf[1] = p[1];
-        if (p[2] > rtf[2]) rtf[2] = p[2];
-        
-        vertices.push_back(p);
-    }
-
-    if(hasNormals)
-    {
-        for(int i = 0; i < mesh->mNumVertices; i++)
-        {
-            aiVector3D n = mesh->mNormals[i];
-            
-            Vec3f vn = Vec3f(n.x, n.y, n.z);
-            
-            normals.push_back(vn);
-        }
-    }
-    
-    offsets.push_back(0);
-    offsets.push_back(mesh->mNumFaces*3);
-    
-    //// the center of the 3d bounding box
-    // Vec3f bbCenter = (rtf + lbn) / 2;
-
-    //// compute a normalization transform that moves the object to the center of its bounding box and scales it according to the prescribed factor
-    // T_n = Transformations::scaleMatrix(scaling) * Transformations::translationMatrix(-bbCenter[0], -bbCenter[1], -bbCenter[2]);
-
-    // T_n = Transformations::scaleMatrix(scaling);
-
-//#define DELETE_EXTRA_VERTEX
-#ifdef DELETE_EXTRA_VERTEX
-    if (tk::IsFileExist(modelFilename + 's')) 
-    {
-      //loadSimpleModel(modelFilename + 's');
-      Assimp::Importer importer;
-      const aiScene* scene = importer.ReadFile(modelFilename, aiProcessPreset_TargetRealtime_Fast);
-      aiMesh *smesh = scene->mMeshes[0];
-      IdentAdd(svertices, smesh->mVertices, smesh->mNumVertices);
-    } 
-    else 
-    {
-      //svertices = vertices;
-      IdentAdd(svertices, mesh->mVertices, mesh->mNumVertices);
-    }
-#else
-    if (IsFileExist(modelFilename + 's')) 
-    {
-      loadSimpleModel(modelFilename + 's');
-    } 
-    else 
-    {
-      svertices = vertices;
-    }
-#endif
-
-#define ADD_EDGE_VERTEX
-#ifdef ADD_EDGE_VERTEX
-    if (mesh->mNumVertices < 24*3) 
-    {
-      std::vector<aiVector3D> setv;
-
-      for(int i = 0; i < mesh->mNumFaces; i++) 
-      {
-        aiFace f = mesh->mFaces[i];
-
-        aiVector3D dv;
-
-        dv = mesh->mVertices[f.mIndices[0]] - mesh->mVertices[f.mIndices[1]];
-        IdenInsert(setv, mesh->mVertices[f.mIndices[1]] + 0.2f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[1]] + 0.4f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[1]] + 0.6f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[1]] + 0.8f * dv);
-
-        dv = mesh->mVertices[f.mIndices[1]] - mesh->mVertices[f.mIndices[2]];
-        IdenInsert(setv, mesh->mVertices[f.mIndices[2]] + 0.2f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[2]] + 0.4f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[2]] + 0.6f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[2]] + 0.8f * dv);
-
-        dv = mesh->mVertices[f.mIndices[2]] - mesh->mVertices[f.mIndices[0]];
-        IdenInsert(setv, mesh->mVertices[f.mIndices[0]] + 0.2f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[0]] + 0.4f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[0]] + 0.6f * dv);
-        IdenInsert(setv, mesh->mVertices[f.mIndices[0]] + 0.8f * dv);
-      }
-
-      svertices = vertices;
-      int si = setv.size();
-
-      for (auto vert : setv) 
-      {
-        svertices.push_back(Vec3f(vert.x, vert.y, vert.z));
-      }
-    }
-#endif
-
-    importer.FreeScene();
+    return m_id;
 }
 
-void Model::loadSimpleModel(const string modelFilename) 
+
+void Model::setModelID(int i)
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(modelFilename, aiProcessPreset_TargetRealtime_Fast);
-    aiMesh* mesh = scene->mMeshes[0];
+    m_id = i;
+}
 
-    for (int i = 0; i < mesh->mNumVertices; i++) {
-        aiVector3D v = mesh->mVertices[i];
-        Vec3f p(v.x, v.y, v.z);
-        svertices.push_back(p);
-    }
 
-    importer.FreeScene();
+void Model::reset()
+{
+    initialized = false;
+    
+    T_cm = T_i;
+    T_pm = T_i;
 }
@@ -1,11 +1,13 @@
 #pragma once
 
-#include <QOpenGLBuffer>
+#include <memory>
+
 #include <QOpenGLShaderProgram>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "model_asset.h"
 #include "transformations.h"
 
 /**
@@ -14,7 +16,8 @@
  *  model data from a specified file, drawing the model with OpenGL
  *  as well as calculating the bounding box of the model and setting
  *  individual vertex colors. The model data is uploaded to the GPU in
- *  form of VertexBufferObjects.
+ *  form of VertexBufferObjects. The geometry is a ModelAsset shared by
+ *  all instances of the same file, a model only adds its pose and ID.
  */
 class Model
 {
@@ -38,23 +41,26 @@ public:
      */
     Model(const std::string modelFilename, float tx, float ty, float tz, float alpha, float beta, float gamma, float scale);
     Model(const std::string modelFilename, const cv::Matx44f& Ti, float scale);
+    Model(std::shared_ptr<ModelAsset> asset, const cv::Matx44f& Ti, float scale);
 
     ~Model();
 		
-		void Init(const std::string modelFilename, const cv::Matx44f& Ti, float scale);
+		void Init(std::shared_ptr<ModelAsset> asset, const cv::Matx44f& Ti, float scale);
 
     /**
      *  Draws the model with a given shader programm and
-     *  a specified OpenGL data primitive type using VBOs.
+     *  a specified OpenGL data primitive type using VBOs. All parts of
+     *  the model are drawn with a single call.
      *
-     *  @param  program    The shader programm to be used.
+     *  @param  program    The bound shader programm to be used.
      *  @param  primitives The primitive type that shall be used for drawing (e.g. GL_POINTS, GL_LINES,...). The default value is set to GL_TRIANGLES.
      */
     void draw(QOpenGLShaderProgram *program, GLint primitives = GL_TRIANGLES);
     
     /**
-     *  The 3d data is packed into VOBs and uploaded to the GPU.
-     *  Should be called after a valid OpenGL context exists.
+     *  The 3d data is packed into one interleaved VBO and an IBO, whose
+     *  attribute setup is recorded in a VAO, and uploaded to the GPU once
+     *  per asset. Should be called after a valid OpenGL context exists.
      *  Must be called before a model can get rendered!
      */
     void initBuffers();
@@ -154,14 +160,47 @@ public:
      */
     float getScaling();
     
+    /**
+     *  Returns the path of the file the model has been loaded from.
+     *
+     *  @return  The model file name as specified in the constructor.
+     */
+    std::string getModelFilename();
+
+    /**
+     *  Returns the geometry shared with all other instances of the model file.
+     *
+     *  @return  The shared model asset.
+     */
+    std::shared_ptr<ModelAsset> getAsset();
+    
     /**
      *  Returns a vector containing all unnormalized 3D model
      *  verticies [X_m, Y_m, Z_m].
      *
      *  @return  A vector containing all unnormalized 3D model verticies.
      */
-    std::vector<cv::Vec3f> getVertices();
-    std::vector<cv::Vec3f> getSimpleVertices();
+    const std::vector<cv::Vec3f>& getVertices() const;
+    const std::vector<GLuint>& getIndices() const;
+    const std::vector<cv::Vec3f>& getSimpleVertices();
+    
+    /**
+     *  Returns the verticies as structure-of-arrays for the batch projection
+     *  of the PointProjector.
+     *
+     *  @return  All 3D model verticies, respectively the simplified ones used for the tclc-histograms.
+     */
+    const PointsSoA& getVerticesSoA();
+    const PointsSoA& getSimpleVerticesSoA();
+    
+    /**
+     *  Returns the view-dependent lists of simple verticies that can lie on the
+     *  silhouette. They are empty for small models and if the simple verticies
+     *  come from a separate simple model.
+     *
+     *  @return  The silhouette candidates of the simple verticies.
+     */
+    const SilhouetteCandidates& getSilhouetteCandidates();
 
     /**
      *  Returns the total number of 3D model verticies.
@@ -194,9 +233,6 @@ public:
      *  and initialization state to false.
      */
     void reset();
-    
-    std::vector<cv::Vec3f> vertices;
-    std::vector<GLuint> indices;
 
 private:
     int m_id;
@@ -210,30 +246,7 @@ private:
     
     bool initialized;
     
-    bool hasNormals;
-    
-    //std::vector<cv::Vec3f> vertices;
-    std::vector<cv::Vec3f> svertices;
-    std::vector<cv::Vec3f> normals;
-    //std::vector<GLuint> indices;
-    std::vector<GLuint> offsets;
-    
-    QOpenGLBuffer vertexBuffer;
-    QOpenGLBuffer normalBuffer;
-    QOpenGLBuffer indexBuffer;
-    
-    bool buffersInitialsed;
-    
-    cv::Vec3f lbn;
-    cv::Vec3f rtf;
     float scaling;
     
-    
-    /**
-     *  Loads the model data from the specified file.
-     *
-     *  @param  objFilename The relative path to the OBJ/PLY file.
-     */
-    void loadModel(const std::string modelFilename);
-    void loadSimpleModel(const std::string modelFilename);
+    std::shared_ptr<ModelAsset> asset;
 };
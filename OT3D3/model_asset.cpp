@@ -0,0 +1,586 @@
+#include <limits>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <assimp/scene.h>
+#include <assimp/mesh.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+
+#include "utils.h"
+#include "tinyply.h"
+#include "model_asset.h"
+#include "mapped_file.h"
+#include "global_params.h"
+
+using namespace std;
+using namespace cv;
+
+// below this many mesh vertices projecting all of them is as fast as looking up the silhouette candidates
+static const size_t kMinSilhouetteVertices = 2000;
+
+std::mutex ModelAsset::registryMutex;
+std::map<std::string, std::weak_ptr<ModelAsset> > ModelAsset::registry;
+
+shared_ptr<ModelAsset> ModelAsset::Get(const string& modelFilename)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    shared_ptr<ModelAsset> asset = registry[modelFilename].lock();
+    if (!asset)
+    {
+        asset = std::make_shared<ModelAsset>(modelFilename);
+        registry[modelFilename] = asset;
+    }
+    return asset;
+}
+
+ModelAsset::ModelAsset(const string& modelFilename)
+{
+    this->modelFilename = modelFilename;
+
+    hasNormals = false;
+    buffersInitialsed = false;
+    meshHash = 0;
+
+    vertexBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    indexBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+
+    loadModel(modelFilename);
+}
+
+ModelAsset::~ModelAsset()
+{
+    if(buffersInitialsed)
+    {
+        vertexArray.destroy();
+
+        vertexBuffer.release();
+        vertexBuffer.destroy();
+        
+        indexBuffer.release();
+        indexBuffer.destroy();
+    }
+}
+
+void ModelAsset::initBuffers()
+{
+    if (buffersInitialsed)
+        return;
+
+    // positions and normals interleaved in one buffer
+    std::vector<Vec3f> interleaved(2 * vertices.size());
+    for (int i = 0; i < vertices.size(); i++)
+    {
+        interleaved[2 * i] = vertices[i];
+        interleaved[2 * i + 1] = i < normals.size() ? normals[i] : Vec3f(0, 0, 0);
+    }
+
+    // the attribute setup is recorded once in the vertex array object
+    vertexArray.create();
+    vertexArray.bind();
+
+    vertexBuffer.create();
+    vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vertexBuffer.bind();
+    vertexBuffer.allocate(interleaved.data(), (int)interleaved.size() * sizeof(Vec3f));
+    
+    indexBuffer.create();
+    indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    indexBuffer.bind();
+    indexBuffer.allocate(indices.data(), (int)indices.size() * sizeof(int));
+
+    QOpenGLFunctions* gl = QOpenGLContext::currentContext()->functions();
+    gl->glEnableVertexAttribArray(kPositionLocation);
+    gl->glVertexAttribPointer(kPositionLocation, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(Vec3f), (const GLvoid*)0);
+    gl->glEnableVertexAttribArray(kNormalLocation);
+    gl->glVertexAttribPointer(kNormalLocation, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(Vec3f), (const GLvoid*)sizeof(Vec3f));
+
+    vertexArray.release();
+    
+    buffersInitialsed = true;
+}
+
+void ModelAsset::draw(GLint primitives)
+{
+    // the parts are stored back to back, so one call draws all of them
+    vertexArray.bind();
+    glDrawElements(primitives, offsets.back(), GL_UNSIGNED_INT, (GLvoid*)0);
+    vertexArray.release();
+}
+
+
+template <typename T>
+void IdenInsert(std::vector<T>& verts, const T& vert)
+{
+    for (int i = 0; i < verts.size(); ++i) {
+        if (verts[i] == vert)
+            return;
+    }
+
+    verts.push_back(vert);
+}
+
+static Vec3f ToVec3f(const aiVector3D& v) { return Vec3f(v.x, v.y, v.z); }
+static Vec3f ToVec3f(const Vec3f& v) { return v; }
+
+template <typename T>
+void IdentAdd(std::vector<Vec3f>& vertices, const T* v, unsigned int num) {
+    vertices.clear();
+
+    std::vector<T> setv;
+
+    for (int i = 0; i < num; ++i) {
+        IdenInsert(setv, v[i]);
+    }
+
+    for (auto vert : setv) {
+        vertices.push_back(ToVec3f(vert));
+    }
+}
+
+void ModelAsset::loadModel(const string modelFilename)
+{
+    bool useCache = OT3D::GlobalParam::Instance()->modelCache != 0;
+    string cacheFilename = modelFilename + ".cache";
+
+    if (!useCache || !loadCache(cacheFilename, modelFilename))
+    {
+        importModel(modelFilename);
+
+        if (useCache)
+            saveCache(cacheFilename, modelFilename);
+    }
+
+    verticesSoA.assign(vertices);
+    sverticesSoA.assign(svertices);
+
+    // the candidate lists index the mesh verticies or the surface samples, so they do not apply to a separate simple model,
+    // the surface samples always use them, the lists also cut down the projected points the centers are filtered from
+    bool sampled = !sampleFaces.empty();
+    bool meshVertices = svertices.size() == vertices.size() && svertices.size() >= kMinSilhouetteVertices;
+    if ((sampled || meshVertices) && !IsFileExist(modelFilename + 's'))
+    {
+      string silhouetteFilename = modelFilename + ".silhouette";
+      if (!silhouetteCandidates.Load(silhouetteFilename, meshHash, (int)svertices.size()))
+      {
+        silhouetteCandidates.Build(vertices, indices, 4, 0.15f, sampled ? &sampleFaces : NULL);
+        silhouetteCandidates.Save(silhouetteFilename, meshHash);
+      }
+    }
+}
+
+void ModelAsset::importModel(const string modelFilename)
+{
+    string extension = std::filesystem::path(modelFilename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    bool isPly = extension == ".ply";
+    if (!(isPly && OT3D::GlobalParam::Instance()->fastPly && importPly(modelFilename)))
+    {
+        importAssimp(modelFilename);
+    }
+
+    float inf = numeric_limits<float>::infinity();
+    lbn = Vec3f(inf, inf, inf);
+    rtf = Vec3f(-inf, -inf, -inf);
+    
+    for (auto& p : vertices)
+    {
+        // compute the 3D bounding box of the model
+        if (p[0] < lbn[0]) lbn[0] = p[0];
+        if (p[1] < lbn[1]) lbn[1] = p[1];
+        if (p[2] < lbn[2]) lbn[2] = p[2];
+        if (p[0] > rtf[0]) rtf[0] = p[0];
+        if (p[1] > rtf[1]) rtf[1] = p[1];
+        if (p[2] > rtf[2]) rtf[2] = p[2];
+    }
+    
+    //// the center of the 3d bounding box
+    // Vec3f bbCenter = (rtf + lbn) / 2;
+
+    //// compute a normalization transform that moves the object to the center of its bounding box and scales it according to the prescribed factor
+    // T_n = Transformations::scaleMatrix(scaling) * Transformations::translationMatrix(-bbCenter[0], -bbCenter[1], -bbCenter[2]);
+
+    // T_n = Transformations::scaleMatrix(scaling);
+
+    // the sample, silhouette and contour files are only valid for exactly these vertices
+    meshHash = HashMesh(vertices, indices);
+
+//#define DELETE_EXTRA_VERTEX
+#ifdef DELETE_EXTRA_VERTEX
+    if (tk::IsFileExist(modelFilename + 's')) 
+    {
+      //loadSimpleModel(modelFilename + 's');
+      Assimp::Importer importer;
+      const aiScene* scene = importer.ReadFile(modelFilename, aiProcessPreset_TargetRealtime_Fast);
+      aiMesh *smesh = scene->mMeshes[0];
+      IdentAdd(svertices, smesh->mVertices, smesh->mNumVertices);
+    } 
+    else 
+    {
+      //svertices = vertices;
+      IdentAdd(svertices, vertices.data(), (unsigned int)vertices.size());
+    }
+#else
+    if (IsFileExist(modelFilename + 's')) 
+    {
+      loadSimpleModel(modelFilename + 's');
+    } 
+    else if (OT3D::GlobalParam::Instance()->surfaceSamples > 0)
+    {
+      // a fixed number of uniform surface samples, independent of the tessellation
+      int count = OT3D::GlobalParam::Instance()->surfaceSamples;
+      string samplesFilename = modelFilename + ".samples";
+      SurfaceSamples samples;
+      if (!samples.Load(samplesFilename, meshHash, count))
+      {
+        if (samples.Build(vertices, indices, count))
+          samples.Save(samplesFilename, meshHash);
+      }
+      svertices = samples.IsEmpty() ? vertices : samples.GetPoints();
+      sampleFaces = samples.GetFaces();
+    }
+    else 
+    {
+      svertices = vertices;
+    }
+#endif
+
+#define ADD_EDGE_VERTEX
+#ifdef ADD_EDGE_VERTEX
+    if (vertices.size() < 24*3 && sampleFaces.empty()) 
+    {
+      std::vector<Vec3f> setv;
+
+      for(int i = 0; i < indices.size() / 3; i++) 
+      {
+        const GLuint* f = &indices[3 * i];
+
+        Vec3f dv;
+
+        dv = vertices[f[0]] - vertices[f[1]];
+        IdenInsert(setv, vertices[f[1]] + 0.2f * dv);
+        IdenInsert(setv, vertices[f[1]] + 0.4f * dv);
+        IdenInsert(setv, vertices[f[1]] + 0.6f * dv);
+        IdenInsert(setv, vertices[f[1]] + 0.8f * dv);
+
+        dv = vertices[f[1]] - vertices[f[2]];
+        IdenInsert(setv, vertices[f[2]] + 0.2f * dv);
+        IdenInsert(setv, vertices[f[2]] + 0.4f * dv);
+        IdenInsert(setv, vertices[f[2]] + 0.6f * dv);
+        IdenInsert(setv, vertices[f[2]] + 0.8f * dv);
+
+        dv = vertices[f[2]] - vertices[f[0]];
+        IdenInsert(setv, vertices[f[0]] + 0.2f * dv);
+        IdenInsert(setv, vertices[f[0]] + 0.4f * dv);
+        IdenInsert(setv, vertices[f[0]] + 0.6f * dv);
+        IdenInsert(setv, vertices[f[0]] + 0.8f * dv);
+      }
+
+      svertices = vertices;
+      svertices.insert(svertices.end(), setv.begin(), setv.end());
+    }
+#endif
+}
+
+
+// appends the triangle meshes of a node and its children, placed by their node transformations
+static void AppendNode(const aiScene* scene, const aiNode* node, const aiMatrix4x4& parent, vector<Vec3f>& vertices, vector<Vec3f>& normals, vector<GLuint>& indices, vector<GLuint>& offsets, bool& hasNormals)
+{
+    aiMatrix4x4 transform = parent * node->mTransformation;
+    aiMatrix3x3 normalTransform = aiMatrix3x3(transform).Inverse().Transpose();
+    bool identity = transform.IsIdentity();
+
+    for (unsigned int m = 0; m < node->mNumMeshes; m++)
+    {
+        const aiMesh* mesh = scene->mMeshes[node->mMeshes[m]];
+        if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+            continue;
+
+        GLuint base = (GLuint)vertices.size();
+        hasNormals = hasNormals && mesh->HasNormals();
+
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            const aiFace& f = mesh->mFaces[i];
+
+            indices.push_back(base + f.mIndices[0]);
+            indices.push_back(base + f.mIndices[1]);
+            indices.push_back(base + f.mIndices[2]);
+        }
+
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            aiVector3D v = identity ? mesh->mVertices[i] : transform * mesh->mVertices[i];
+            vertices.push_back(Vec3f(v.x, v.y, v.z));
+
+            aiVector3D n = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0, 0, 0);
+            if (!identity)
+                n = (normalTransform * n).Normalize();
+            normals.push_back(Vec3f(n.x, n.y, n.z));
+        }
+
+        offsets.push_back((GLuint)indices.size());
+    }
+
+    for (unsigned int c = 0; c < node->mNumChildren; c++)
+    {
+        AppendNode(scene, node->mChildren[c], transform, vertices, normals, indices, offsets, hasNormals);
+    }
+}
+
+void ModelAsset::importAssimp(const string modelFilename)
+{
+    Assimp::Importer importer;
+    
+    const aiScene* scene = importer.ReadFile(modelFilename, aiProcessPreset_TargetRealtime_Fast);
+    
+    // all meshes of an assembly are merged into one model, every mesh is a part with its own index range
+    hasNormals = true;
+    offsets.push_back(0);
+    AppendNode(scene, scene->mRootNode, aiMatrix4x4(), vertices, normals, indices, offsets, hasNormals);
+
+    if(!hasNormals)
+    {
+        normals.clear();
+    }
+
+    importer.FreeScene();
+}
+
+bool ModelAsset::importPly(const string modelFilename)
+{
+    std::ifstream ifs(modelFilename, std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+
+    // tinyply streams the binary or ascii body into the requested arrays and throws
+    // if a property has another type or any face is no triangle, ASSIMP handles those
+    std::vector<float> xyz, nxyz;
+    try
+    {
+        tinyply::PlyFile ply(ifs);
+
+        size_t numVertices = ply.request_properties_from_element("vertex", { "x", "y", "z" }, xyz);
+        size_t numNormals = ply.request_properties_from_element("vertex", { "nx", "ny", "nz" }, nxyz);
+        size_t numFaces = ply.request_properties_from_element("face", { "vertex_indices" }, indices, 3);
+        if (numFaces == 0)
+            numFaces = ply.request_properties_from_element("face", { "vertex_index" }, indices, 3);
+
+        if (numVertices == 0 || numFaces == 0 || xyz.size() != 3 * numVertices)
+            throw std::runtime_error("no triangle mesh");
+
+        ply.read(ifs);
+
+        if (ifs.fail() || indices.size() != 3 * numFaces)
+            throw std::runtime_error("truncated file");
+
+        hasNormals = numNormals == numVertices && nxyz.size() == 3 * numVertices;
+    }
+    catch (const std::exception&)
+    {
+        indices.clear();
+        return false;
+    }
+
+    for (GLuint i : indices)
+    {
+        if (i >= xyz.size() / 3)
+        {
+            indices.clear();
+            return false;
+        }
+    }
+
+    const Vec3f* p = (const Vec3f*)xyz.data();
+    vertices.assign(p, p + xyz.size() / 3);
+
+    offsets.push_back(0);
+    offsets.push_back((GLuint)indices.size());
+
+    if (hasNormals)
+    {
+        const Vec3f* n = (const Vec3f*)nxyz.data();
+        normals.assign(n, n + nxyz.size() / 3);
+    }
+    else
+    {
+        // smooth area-weighted vertex normals, as ASSIMP would generate for the shading
+        normals.assign(vertices.size(), Vec3f(0, 0, 0));
+        for (int i = 0; i < indices.size(); i += 3)
+        {
+            Vec3f n = (vertices[indices[i + 1]] - vertices[indices[i]]).cross(vertices[indices[i + 2]] - vertices[indices[i]]);
+            normals[indices[i]] += n;
+            normals[indices[i + 1]] += n;
+            normals[indices[i + 2]] += n;
+        }
+        for (auto& n : normals)
+        {
+            float len = (float)norm(n);
+            if (len > 0.0f)
+                n /= len;
+        }
+        hasNormals = true;
+    }
+
+    return true;
+}
+
+void ModelAsset::loadSimpleModel(const string modelFilename) 
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(modelFilename, aiProcessPreset_TargetRealtime_Fast);
+    aiMesh* mesh = scene->mMeshes[0];
+
+    for (int i = 0; i < mesh->mNumVertices; i++) {
+        aiVector3D v = mesh->mVertices[i];
+        Vec3f p(v.x, v.y, v.z);
+        svertices.push_back(p);
+    }
+
+    importer.FreeScene();
+}
+
+static const char kModelCacheMagic[6] = { 'O', 'T', '3', 'D', 'M', 'C' };
+static const int kModelCacheVersion = 4;
+
+// size and modification time of a file, zero if it does not exist
+static void FileStamp(const string& file, long long& size, long long& time)
+{
+    std::error_code ec;
+    size = (long long)std::filesystem::file_size(file, ec);
+    if (ec)
+    {
+        size = 0;
+        time = 0;
+        return;
+    }
+    time = (long long)std::filesystem::last_write_time(file, ec).time_since_epoch().count();
+    if (ec)
+        time = 0;
+}
+
+template <typename T>
+static void WriteRaw(std::ofstream& ofs, const T& value)
+{
+    ofs.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static void WriteArray(std::ofstream& ofs, const std::vector<T>& values)
+{
+    WriteRaw(ofs, (long long)values.size());
+    ofs.write((const char*)values.data(), values.size() * sizeof(T));
+}
+
+template <typename T>
+static bool ReadRaw(const char*& p, const char* end, T& value)
+{
+    if (end - p < (ptrdiff_t)sizeof(T))
+        return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+template <typename T>
+static bool ReadArray(const char*& p, const char* end, std::vector<T>& values)
+{
+    long long count = 0;
+    if (!ReadRaw(p, end, count) || count < 0 || (end - p) / (ptrdiff_t)sizeof(T) < count)
+        return false;
+    values.resize((size_t)count);
+    memcpy(values.data(), p, (size_t)count * sizeof(T));
+    p += count * sizeof(T);
+    return true;
+}
+
+// everything the cached data depends on besides the version, without padding so it can be compared bytewise
+struct ModelCacheKey
+{
+    long long modelSize, modelTime;
+    long long simpleSize, simpleTime;
+    long long surfaceSamples;
+    long long fastPly;  // the importers may order and deduplicate the vertices differently
+};
+
+static ModelCacheKey GetCacheKey(const string& modelFilename)
+{
+    ModelCacheKey key;
+    FileStamp(modelFilename, key.modelSize, key.modelTime);
+    FileStamp(modelFilename + 's', key.simpleSize, key.simpleTime);
+    key.surfaceSamples = OT3D::GlobalParam::Instance()->surfaceSamples;
+    key.fastPly = OT3D::GlobalParam::Instance()->fastPly != 0;
+    return key;
+}
+
+bool ModelAsset::loadCache(const string& cacheFilename, const string& modelFilename)
+{
+    MappedFile file;
+    if (!file.Open(cacheFilename))
+        return false;
+
+    const char* p = file.GetData();
+    const char* end = p + file.GetSize();
+
+    char magic[sizeof(kModelCacheMagic)];
+    int version = 0;
+    if (!ReadRaw(p, end, magic) || memcmp(magic, kModelCacheMagic, sizeof(magic)) != 0)
+        return false;
+    if (!ReadRaw(p, end, version) || version != kModelCacheVersion)
+        return false;
+
+    // stale if the model, its simple model, the sampling or the PLY importer changed
+    ModelCacheKey key, current = GetCacheKey(modelFilename);
+    if (!ReadRaw(p, end, key) || memcmp(&key, &current, sizeof(key)) != 0)
+        return false;
+
+    int normalsFlag = 0;
+    if (!ReadRaw(p, end, normalsFlag) || !ReadRaw(p, end, lbn) || !ReadRaw(p, end, rtf) || !ReadRaw(p, end, meshHash)
+        || !ReadArray(p, end, vertices) || !ReadArray(p, end, normals) || !ReadArray(p, end, indices) || !ReadArray(p, end, offsets)
+        || !ReadArray(p, end, svertices) || !ReadArray(p, end, sampleFaces))
+    {
+        vertices.clear();
+        normals.clear();
+        indices.clear();
+        offsets.clear();
+        svertices.clear();
+        sampleFaces.clear();
+        return false;
+    }
+    hasNormals = normalsFlag != 0;
+
+    return true;
+}
+
+bool ModelAsset::saveCache(const string& cacheFilename, const string& modelFilename)
+{
+    std::ofstream ofs(cacheFilename, std::ios::binary);
+    if (!ofs.is_open())
+        return false;
+
+    ModelCacheKey key = GetCacheKey(modelFilename);
+
+    ofs.write(kModelCacheMagic, sizeof(kModelCacheMagic));
+    WriteRaw(ofs, kModelCacheVersion);
+    WriteRaw(ofs, key);
+    WriteRaw(ofs, (int)hasNormals);
+    WriteRaw(ofs, lbn);
+    WriteRaw(ofs, rtf);
+    WriteRaw(ofs, meshHash);
+    WriteArray(ofs, vertices);
+    WriteArray(ofs, normals);
+    WriteArray(ofs, indices);
+    WriteArray(ofs, offsets);
+    WriteArray(ofs, svertices);
+    WriteArray(ofs, sampleFaces);
+
+    return ofs.good();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLShaderProgram>
+
+#include <opencv2/core.hpp>
+
+#include "point_projector.h"
+#include "silhouette_candidates.h"
+
+/**
+ *  The immutable geometry of a 3d model file, shared by all model instances
+ *  of the same part. It holds the mesh, the simplified verticies used for the
+ *  tclc-histograms, their silhouette candidates and the GPU buffers. Assets are
+ *  loaded through Get(), which returns the already loaded asset as long as
+ *  some instance still uses it, so N instances cost one load.
+ */
+class ModelAsset
+{
+public:
+    /**
+     *  The attribute locations of the vertex array object. Shader programs
+     *  must bind aPosition and aNormal to them before linking.
+     */
+    static const int kPositionLocation = 0;
+    static const int kNormalLocation = 1;
+
+    /**
+     *  Returns the shared asset of a model file, loading it if no instance
+     *  uses it yet.
+     *
+     *  @param  modelFilename The relative path to the OBJ/PLY file.
+     *  @return The shared asset.
+     */
+    static std::shared_ptr<ModelAsset> Get(const std::string& modelFilename);
+
+    explicit ModelAsset(const std::string& modelFilename);
+    ~ModelAsset();
+
+    ModelAsset(const ModelAsset&) = delete;
+    ModelAsset& operator=(const ModelAsset&) = delete;
+
+    /**
+     *  Packs the 3d data into one interleaved VBO and an IBO, whose attribute
+     *  setup is recorded in a VAO, and uploads it to the GPU. Only the first
+     *  call per asset uploads, the others return immediately. Must be called
+     *  while the OpenGL context is current.
+     */
+    void initBuffers();
+
+    /**
+     *  Draws all parts of the model with a single call using the bound
+     *  shader program.
+     *
+     *  @param  primitives The primitive type that shall be used for drawing.
+     */
+    void draw(GLint primitives);
+
+    const std::string& getModelFilename() const { return modelFilename; }
+
+    const std::vector<cv::Vec3f>& getVertices() const { return vertices; }
+    const std::vector<cv::Vec3f>& getNormals() const { return normals; }
+    const std::vector<GLuint>& getIndices() const { return indices; }
+    const std::vector<cv::Vec3f>& getSimpleVertices() const { return svertices; }
+
+    const PointsSoA& getVerticesSoA() const { return verticesSoA; }
+    const PointsSoA& getSimpleVerticesSoA() const { return sverticesSoA; }
+
+    const SilhouetteCandidates& getSilhouetteCandidates() const { return silhouetteCandidates; }
+
+    // the hash of the vertices and indices that keys the files derived from the mesh
+    unsigned long long getMeshHash() const { return meshHash; }
+
+    cv::Vec3f getLBN() const { return lbn; }
+    cv::Vec3f getRTF() const { return rtf; }
+
+private:
+    std::string modelFilename;
+
+    bool hasNormals;
+
+    std::vector<cv::Vec3f> vertices;
+    std::vector<cv::Vec3f> normals;
+    std::vector<GLuint> indices;
+    std::vector<GLuint> offsets;
+    unsigned long long meshHash;
+
+    std::vector<cv::Vec3f> svertices;
+    std::vector<int> sampleFaces; // the triangle of every simple vertex if they are surface samples
+    PointsSoA verticesSoA;
+    PointsSoA sverticesSoA;
+    SilhouetteCandidates silhouetteCandidates;
+
+    cv::Vec3f lbn;
+    cv::Vec3f rtf;
+
+    QOpenGLVertexArrayObject vertexArray;
+    QOpenGLBuffer vertexBuffer; // interleaved positions and normals
+    QOpenGLBuffer indexBuffer;
+
+    bool buffersInitialsed;
+
+    static std::mutex registryMutex;
+    static std::map<std::string, std::weak_ptr<ModelAsset> > registry;
+
+    /**
+     *  Loads the model data from the specified file. The imported data is
+     *  cached in <model>.cache, later loads map that file and skip ASSIMP
+     *  while the model, its simple model and the sampling are unchanged.
+     *
+     *  @param  modelFilename The relative path to the OBJ/PLY file.
+     */
+    void loadModel(const std::string modelFilename);
+    void importModel(const std::string modelFilename);
+    void importAssimp(const std::string modelFilename);
+    bool importPly(const std::string modelFilename);
+    void loadSimpleModel(const std::string modelFilename);
+
+    bool loadCache(const std::string& cacheFilename, const std::string& modelFilename);
+    bool saveCache(const std::string& cacheFilename, const std::string& modelFilename);
+};
@@ -1,10 +1,48 @@
+#include <map>
+#include <mutex>
+
+#include <glog/logging.h>
+
 #include "object3d.h"
+#include "global_params.h"
 #include "template_view.h"
+#include "template_cache.h"
 #include "tclc_histograms.h"
 
 using namespace std;
 using namespace cv;
 
+/**
+ *  The base and neighboring templates of a model asset at a set of distances,
+ *  shared by all instances of the asset.
+ */
+struct ObjectTemplates
+{
+    std::vector<float> distances;
+    
+    std::vector<TemplateView*> baseTemplates;
+    std::vector<TemplateView*> neighboringTemplates;
+    
+    // the mapping of templates loaded from <model>.templates, closed after they are deleted
+    TemplateCache cache;
+    
+    ~ObjectTemplates()
+    {
+        for(int i = 0; i < baseTemplates.size(); i++)
+        {
+            delete baseTemplates[i];
+        }
+        
+        for(int i = 0; i < neighboringTemplates.size(); i++)
+        {
+            delete neighboringTemplates[i];
+        }
+    }
+};
+
+static std::mutex templatesMutex;
+static std::map<const ModelAsset*, std::weak_ptr<ObjectTemplates> > templatesRegistry;
+
 bool sortDistance(std::pair<float, int> a, std::pair<float, int> b)
 {
     return a.first < b.first;
@@ -12,6 +50,7 @@ bool sortDistance(std::pair<float, int> a, std::pair<float, int> b)
 
 void Object3D::Init(float qualityThreshold, std::vector<float> &templateDistances) {
     this->trackingLost = false;
+    this->trackingQuality = -1.0f;
     this->qualityThreshold = qualityThreshold;
     this->templateDistances = templateDistances;
     this->numDistances = (int)templateDistances.size();
@@ -82,6 +121,12 @@ Object3D::Object3D(const std::string objFilename, const cv::Matx44f& Ti, float s
 	Init(qualityThreshold, templateDistances);
 }
 
+Object3D::Object3D(std::shared_ptr<ModelAsset> asset, const cv::Matx44f& Ti, float scale, float qualityThreshold, std::vector<float> &templateDistances) 
+	: Model(asset, Ti, scale)
+{
+	Init(qualityThreshold, templateDistances);
+}
+
 Object3D::Object3D(const string objFilename, float tx, float ty, float tz, float alpha, float beta, float gamma, float scale, float qualityThreshold,  vector<float> &templateDistances) 
 	: Model(objFilename, tx, ty, tz, alpha, beta, gamma, scale)
 {
@@ -92,18 +137,6 @@ Object3D::Object3D(const string objFilename, float tx, float ty, float tz, float
 Object3D::~Object3D()
 {
     delete tclcHistograms;
-    
-    for(int i = 0; i < baseTemplates.size(); i++)
-    {
-        delete baseTemplates[i];
-    }
-    baseTemplates.clear();
-    
-    for(int i = 0; i < neighboringTemplates.size(); i++)
-    {
-        delete neighboringTemplates[i];
-    }
-    neighboringTemplates.clear();
 }
 
 
@@ -122,6 +155,16 @@ float Object3D::getQualityThreshold()
     return qualityThreshold;
 }
 
+float Object3D::getTrackingQuality()
+{
+    return trackingQuality;
+}
+
+void Object3D::setTrackingQuality(float val)
+{
+    trackingQuality = val;
+}
+
 
 TCLCHistograms *Object3D::getTCLCHistograms()
 {
@@ -134,47 +177,70 @@ void Object3D::SetTCLCHistograms(TCLCHistograms* histograms) {
 
 void Object3D::generateTemplates()
 {
+    const ModelAsset* key = getAsset().get();
+    {
+        std::lock_guard<std::mutex> lock(templatesMutex);
+        
+        std::shared_ptr<ObjectTemplates> shared = templatesRegistry[key].lock();
+        if (shared && shared->distances == templateDistances)
+        {
+            templates = shared;
+            return;
+        }
+    }
+    
+    templates = std::make_shared<ObjectTemplates>();
+    templates->distances = templateDistances;
+    
+    std::vector<TemplateView*>& baseTemplates = templates->baseTemplates;
+    std::vector<TemplateView*>& neighboringTemplates = templates->neighboringTemplates;
+    
     int numLevels = 4;
     
     int numBaseRotations = 4;
     
-    // create all base templates
     int gammaPrecision = 90;
-    for(int i = 0; i < baseIcosahedron.size(); i++)
+    int gamma2Precision = 30;
+    
+    int numBaseTemplates = (int)baseIcosahedron.size()*(360/gammaPrecision)*numDistances;
+    int numNeighboringTemplates = (int)subdivIcosahedron.size()*(360/gamma2Precision)*numDistances;
+    
+    // map the templates of an earlier run if nothing they depend on has changed
+    bool useCache = OT3D::GlobalParam::Instance()->templateCache != 0;
+    std::string cacheFilename = getModelFilename() + ".templates";
+    unsigned long long cacheKey = useCache ? TemplateCache::ComputeKey(this, templateDistances, numLevels) : 0;
+    
+    std::vector<TemplateView*> cached;
+    if(useCache && templates->cache.Load(cacheFilename, cacheKey, numBaseTemplates + numNeighboringTemplates, cached))
     {
-        Vec3f v = baseIcosahedron[i];
-        
-        float r = norm(v);
-        float alpha = acos(v[1]/r)*180.0f/float(CV_PI) - 90.0f;
-        float beta = atan2(v[0], v[2])*180.0f/float(CV_PI);
+        baseTemplates.assign(cached.begin(), cached.begin() + numBaseTemplates);
+        neighboringTemplates.assign(cached.begin() + numBaseTemplates, cached.end());
+    }
+    else
+    {
+        renderTemplates(numLevels, gammaPrecision, gamma2Precision);
         
-        for(int gamma = 0; gamma < 360; gamma += gammaPrecision)
+        if(useCache)
         {
-            for(int d = 0; d < numDistances; d++)
-            {
-                baseTemplates.push_back(new TemplateView(this, alpha, beta, gamma, templateDistances[d], numLevels, true));
-            }
+            cached = baseTemplates;
+            cached.insert(cached.end(), neighboringTemplates.begin(), neighboringTemplates.end());
+            TemplateCache::Save(cacheFilename, cacheKey, cached);
         }
     }
     
-    // create all neighboring templates
-    int gamma2Precision = 30;
-    for(int i = 0; i < subdivIcosahedron.size(); i++)
+    size_t memory = 0, pixelMemory = 0, perPixelMemory = 0;
+    for(int i = 0; i < numBaseTemplates + numNeighboringTemplates; i++)
     {
-        Vec3f v = subdivIcosahedron[i];
-        
-        float r = norm(v);
-        float alpha = acos(v[1]/r)*180.0f/float(CV_PI) - 90.0f;
-        float beta = atan2(v[0], v[2])*180.0f/float(CV_PI);
-        
-        for(int gamma = 0; gamma < 360; gamma += gamma2Precision)
+        TemplateView *kv = i < numBaseTemplates ? baseTemplates[i] : neighboringTemplates[i - numBaseTemplates];
+        memory += kv->getMemory();
+        for(int level = 0; level < numLevels; level++)
         {
-            for(int d = 0; d < numDistances; d++)
-            {
-                neighboringTemplates.push_back(new TemplateView(this, alpha, beta, gamma, templateDistances[d], numLevels, true));
-            }
+            pixelMemory += kv->getCompressedPixelData(level).getMemory();
+            perPixelMemory += kv->getCompressedPixelData(level).getPerPixelMemory();
         }
     }
+    LOG(INFO) << "Templates of " << getModelFilename() << ": " << memory/1024 << " KB, " << pixelMemory/1024
+        << " KB of it compressed pixel data, which takes " << perPixelMemory/1024 << " KB with per-pixel allocations";
     
     // associate each base template with its corresponding neighboring templates
     int gamma2Steps = 360/gamma2Precision;
@@ -217,14 +283,62 @@ void Object3D::generateTemplates()
         }
     }
     
+    {
+        std::lock_guard<std::mutex> lock(templatesMutex);
+        templatesRegistry[key] = templates;
+    }
+    
     // reset the model to its prescribed initial pose
     Model::reset();
 }
 
 
+void Object3D::renderTemplates(int numLevels, int gammaPrecision, int gamma2Precision)
+{
+    std::vector<TemplateView*>& baseTemplates = templates->baseTemplates;
+    std::vector<TemplateView*>& neighboringTemplates = templates->neighboringTemplates;
+    
+    // create all base templates
+    for(int i = 0; i < baseIcosahedron.size(); i++)
+    {
+        Vec3f v = baseIcosahedron[i];
+        
+        float r = norm(v);
+        float alpha = acos(v[1]/r)*180.0f/float(CV_PI) - 90.0f;
+        float beta = atan2(v[0], v[2])*180.0f/float(CV_PI);
+        
+        for(int gamma = 0; gamma < 360; gamma += gammaPrecision)
+        {
+            for(int d = 0; d < numDistances; d++)
+            {
+                baseTemplates.push_back(new TemplateView(this, alpha, beta, gamma, templateDistances[d], numLevels, true));
+            }
+        }
+    }
+    
+    // create all neighboring templates
+    for(int i = 0; i < subdivIcosahedron.size(); i++)
+    {
+        Vec3f v = subdivIcosahedron[i];
+        
+        float r = norm(v);
+        float alpha = acos(v[1]/r)*180.0f/float(CV_PI) - 90.0f;
+        float beta = atan2(v[0], v[2])*180.0f/float(CV_PI);
+        
+        for(int gamma = 0; gamma < 360; gamma += gamma2Precision)
+        {
+            for(int d = 0; d < numDistances; d++)
+            {
+                neighboringTemplates.push_back(new TemplateView(this, alpha, beta, gamma, templateDistances[d], numLevels, true));
+            }
+        }
+    }
+}
+
+
 vector<TemplateView*> Object3D::getTemplateViews()
 {
-    return baseTemplates;
+    return templates ? templates->baseTemplates : vector<TemplateView*>();
 }
 
 
@@ -234,6 +348,18 @@ int Object3D::getNumDistances()
 }
 
 
+const vector<Vec3f>& Object3D::getBaseIcosahedron() const
+{
+    return baseIcosahedron;
+}
+
+
+const vector<Vec3f>& Object3D::getSubdivIcosahedron() const
+{
+    return subdivIcosahedron;
+}
+
+
 void Object3D::reset()
 {
     Model::reset();
@@ -242,4 +368,5 @@ void Object3D::reset()
 			tclcHistograms->clear();
     
     trackingLost = false;
+    trackingQuality = -1.0f;
 }
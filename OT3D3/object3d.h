@@ -1,9 +1,12 @@
 #pragma once
 
+#include <memory>
+
 #include "model.h"
 
 class TCLCHistograms;
 class TemplateView;
+struct ObjectTemplates;
 
 /**
  *  A representation of a 3D object that provides all nessecary information
@@ -34,6 +37,7 @@ public:
      */
     Object3D(const std::string objFilename, float tx, float ty, float tz, float alpha, float beta, float gamma, float scale, float qualityThreshold, std::vector<float> &templateDistances);
     Object3D(const std::string objFilename, const cv::Matx44f& Ti, float scale, float qualityThreshold, std::vector<float> &templateDistances);
+    Object3D(std::shared_ptr<ModelAsset> asset, const cv::Matx44f& Ti, float scale, float qualityThreshold, std::vector<float> &templateDistances);
 		~Object3D();
 
     void Init(float qualityThreshold, std::vector<float> &templateDistances);
@@ -60,6 +64,17 @@ public:
      *  @return  The tracking quality threshold.
      */
     float getQualityThreshold();
+    
+    /**
+     *  Returns the tracking quality of the object in the last frame, the mean
+     *  probability that the pixels on both sides of its search line edges are
+     *  segmented correctly. 0.5 is no better than chance.
+     *
+     *  @return  The tracking quality in [0, 1], negative if it has not been estimated.
+     */
+    float getTrackingQuality();
+    
+    void setTrackingQuality(float val);
 
     /**
      *  Returns the set of tclc-histograms associated with this object.
@@ -71,7 +86,12 @@ public:
 
     /**
      *  Generates all base and neighboring templates required for
-     *  the pose detection algorithm after a tracking loss.
+     *  the pose detection algorithm after a tracking loss. Instances
+     *  of the same model file with the same template distances share
+     *  the templates, only the first one renders them. The rendered
+     *  templates are cached in <model>.templates, later runs map
+     *  that file while it matches the model, histograms, camera
+     *  and distances.
      *  Must be called after the rendering buffers of the
      *  corresponding 3D model have been initialized and while
      *  the offscreen rendering OpenGL context is active.
@@ -100,12 +120,30 @@ public:
      */
     void reset();
     
+    /**
+     *  Returns the vertices of the icosahedron whose directions define the
+     *  viewpoints of the base templates.
+     *
+     *  @return  The 12 icosahedron vertices.
+     */
+    const std::vector<cv::Vec3f>& getBaseIcosahedron() const;
+    
+    /**
+     *  Returns the vertices of the once sub-divided icosahedron whose directions
+     *  define the viewpoints of the neighboring templates.
+     *
+     *  @return  The 42 sub-divided icosahedron vertices.
+     */
+    const std::vector<cv::Vec3f>& getSubdivIcosahedron() const;
+    
     int fcount;
 private:
     bool trackingLost;
     
     float qualityThreshold;
     
+    float trackingQuality;
+    
     int numDistances;
     
     std::vector<float> templateDistances;
@@ -115,7 +153,8 @@ private:
     
     TCLCHistograms *tclcHistograms;
     
-    std::vector<TemplateView*> baseTemplates;
-    std::vector<TemplateView*> neighboringTemplates;
+    std::shared_ptr<ObjectTemplates> templates;
+    
+    void renderTemplates(int numLevels, int gammaPrecision, int gamma2Precision);
     
 };
@@ -0,0 +1,236 @@
+#include <cmath>
+
+#include "cpu_features.h"
+#include "point_projector.h"
+
+void PointsSoA::assign(const std::vector<cv::Vec3f>& points) {
+	x.resize(points.size());
+	y.resize(points.size());
+	z.resize(points.size());
+
+	for (int i = 0; i < points.size(); i++) {
+		x[i] = points[i][0];
+		y[i] = points[i][1];
+		z[i] = points[i][2];
+	}
+}
+
+PointProjector::PointProjector(const cv::Matx44f& K, const cv::Matx44f& T) : PointProjector(K.get_minor<3, 3>(0, 0), T) {
+}
+
+PointProjector::PointProjector(const cv::Matx33f& K, const cv::Matx44f& T) {
+	cv::Matx34f KT = K * T.get_minor<3, 4>(0, 0);
+	for (int r = 0; r < 3; r++)
+	for (int c = 0; c < 4; c++) {
+		P[r][c] = KT(r, c);
+	}
+}
+
+cv::Vec2f PointProjector::Project(const cv::Vec3f& point) const {
+	float pu = P[0][0] * point[0] + P[0][1] * point[1] + P[0][2] * point[2] + P[0][3];
+	float pv = P[1][0] * point[0] + P[1][1] * point[1] + P[1][2] * point[2] + P[1][3];
+	float pz = P[2][0] * point[0] + P[2][1] * point[1] + P[2][2] * point[2] + P[2][3];
+
+	float dz = 1.0f / pz;
+	return cv::Vec2f(pu * dz, pv * dz);
+}
+
+void PointProjector::Project(const std::vector<cv::Vec3f>& points, std::vector<cv::Vec2f>& image_points) const {
+	image_points.resize(points.size());
+	for (int i = 0; i < points.size(); i++) {
+		image_points[i] = Project(points[i]);
+	}
+}
+
+void PointProjector::Project(const PointsSoA& points, int begin, int end, float* u, float* v, float* z) const {
+	const float* X = points.x.data();
+	const float* Y = points.y.data();
+	const float* Z = points.z.data();
+
+	int i = begin;
+
+#ifdef OT3D_AVX2
+	if (HasAVX2())
+		i = ProjectAVX2(points, begin, end, u, v, z);
+#endif
+
+	for (; i < end; i++) {
+		float pu = P[0][0] * X[i] + P[0][1] * Y[i] + P[0][2] * Z[i] + P[0][3];
+		float pv = P[1][0] * X[i] + P[1][1] * Y[i] + P[1][2] * Z[i] + P[1][3];
+		float pz = P[2][0] * X[i] + P[2][1] * Y[i] + P[2][2] * Z[i] + P[2][3];
+
+		u[i] = pu / pz;
+		v[i] = pv / pz;
+		z[i] = pz;
+	}
+}
+
+int PointProjector::ProjectVisible(const PointsSoA& points, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids) const {
+	return ProjectVisibleBatch<false>(points, NULL, begin, end, depth, zNear, zFar, tolerance, u, v, ids);
+}
+
+int PointProjector::ProjectVisible(const PointsSoA& points, const int* indices, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids) const {
+	return ProjectVisibleBatch<true>(points, indices, begin, end, depth, zNear, zFar, tolerance, u, v, ids);
+}
+
+template <bool indexed>
+int PointProjector::ProjectVisibleBatch(const PointsSoA& points, const int* indices, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids) const {
+	const float* X = points.x.data();
+	const float* Y = points.y.data();
+	const float* Z = points.z.data();
+	const float* depthData = depth.ptr<float>();
+
+	int cols = depth.cols;
+	int rows = depth.rows;
+
+	int count = 0;
+	int i = begin;
+
+#ifdef OT3D_AVX2
+	if (HasAVX2())
+		i = ProjectVisibleAVX2<indexed>(points, indices, begin, end, depth, zNear, zFar, tolerance, u, v, ids, count);
+#endif
+
+	for (; i < end; i++) {
+		int k = indexed ? indices[i] : i;
+		float pu = P[0][0] * X[k] + P[0][1] * Y[k] + P[0][2] * Z[k] + P[0][3];
+		float pv = P[1][0] * X[k] + P[1][1] * Y[k] + P[1][2] * Z[k] + P[1][3];
+		float pz = P[2][0] * X[k] + P[2][1] * Y[k] + P[2][2] * Z[k] + P[2][3];
+
+		float x = pu / pz;
+		float y = pv / pz;
+		if (!(x >= 0 && x < cols && y >= 0 && y < rows))
+			continue;
+
+		float d = 1.0f - depthData[(int)y * cols + (int)x];
+		float zd = 2.0f * zNear * zFar / (zFar + zNear - (2.0f * d - 1.0f) * (zFar - zNear));
+
+		if (fabs(pz - zd) < tolerance || d == 1.0f) {
+			u[count] = x;
+			v[count] = y;
+			ids[count] = k;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+#ifdef OT3D_AVX2
+OT3D_TARGET_AVX2 int PointProjector::ProjectAVX2(const PointsSoA& points, int begin, int end, float* u, float* v, float* z) const {
+	const float* X = points.x.data();
+	const float* Y = points.y.data();
+	const float* Z = points.z.data();
+
+	int i = begin;
+
+	__m256 p[3][4];
+	for (int r = 0; r < 3; r++)
+	for (int c = 0; c < 4; c++) {
+		p[r][c] = _mm256_set1_ps(P[r][c]);
+	}
+
+	for (; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(X + i);
+		__m256 y = _mm256_loadu_ps(Y + i);
+		__m256 w = _mm256_loadu_ps(Z + i);
+
+		__m256 pu = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[0][0], x), _mm256_mul_ps(p[0][1], y)), _mm256_add_ps(_mm256_mul_ps(p[0][2], w), p[0][3]));
+		__m256 pv = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[1][0], x), _mm256_mul_ps(p[1][1], y)), _mm256_add_ps(_mm256_mul_ps(p[1][2], w), p[1][3]));
+		__m256 pz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[2][0], x), _mm256_mul_ps(p[2][1], y)), _mm256_add_ps(_mm256_mul_ps(p[2][2], w), p[2][3]));
+
+		_mm256_storeu_ps(u + i, _mm256_div_ps(pu, pz));
+		_mm256_storeu_ps(v + i, _mm256_div_ps(pv, pz));
+		_mm256_storeu_ps(z + i, pz);
+	}
+
+	return i;
+}
+
+template <bool indexed>
+OT3D_TARGET_AVX2 int PointProjector::ProjectVisibleAVX2(const PointsSoA& points, const int* indices, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids, int& count) const {
+	const float* X = points.x.data();
+	const float* Y = points.y.data();
+	const float* Z = points.z.data();
+	const float* depthData = depth.ptr<float>();
+
+	int cols = depth.cols;
+	int rows = depth.rows;
+
+	int i = begin;
+
+	__m256 p[3][4];
+	for (int r = 0; r < 3; r++)
+	for (int c = 0; c < 4; c++) {
+		p[r][c] = _mm256_set1_ps(P[r][c]);
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	const __m256 width = _mm256_set1_ps((float)cols);
+	const __m256 height = _mm256_set1_ps((float)rows);
+	const __m256 nf2 = _mm256_set1_ps(2.0f * zNear * zFar);
+	const __m256 fpn = _mm256_set1_ps(zFar + zNear);
+	const __m256 fmn = _mm256_set1_ps(zFar - zNear);
+	const __m256 tol = _mm256_set1_ps(tolerance);
+	const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const __m256i stride = _mm256_set1_epi32(cols);
+
+	float xs[8];
+	float ys[8];
+
+	for (; i + 8 <= end; i += 8) {
+		__m256 x, y, w;
+		if (indexed) {
+			__m256i vi = _mm256_loadu_si256((const __m256i*)(indices + i));
+			x = _mm256_i32gather_ps(X, vi, 4);
+			y = _mm256_i32gather_ps(Y, vi, 4);
+			w = _mm256_i32gather_ps(Z, vi, 4);
+		} else {
+			x = _mm256_loadu_ps(X + i);
+			y = _mm256_loadu_ps(Y + i);
+			w = _mm256_loadu_ps(Z + i);
+		}
+
+		__m256 pu = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[0][0], x), _mm256_mul_ps(p[0][1], y)), _mm256_add_ps(_mm256_mul_ps(p[0][2], w), p[0][3]));
+		__m256 pv = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[1][0], x), _mm256_mul_ps(p[1][1], y)), _mm256_add_ps(_mm256_mul_ps(p[1][2], w), p[1][3]));
+		__m256 pz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[2][0], x), _mm256_mul_ps(p[2][1], y)), _mm256_add_ps(_mm256_mul_ps(p[2][2], w), p[2][3]));
+
+		__m256 px = _mm256_div_ps(pu, pz);
+		__m256 py = _mm256_div_ps(pv, pz);
+
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(px, zero, _CMP_GE_OQ), _mm256_cmp_ps(px, width, _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(py, zero, _CMP_GE_OQ), _mm256_cmp_ps(py, height, _CMP_LT_OQ)));
+		if (_mm256_testz_ps(inside, inside))
+			continue;
+
+		// gather the rendered depth of the inside lanes only
+		__m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(py), stride), _mm256_cvttps_epi32(px));
+		idx = _mm256_and_si256(idx, _mm256_castps_si256(inside));
+		__m256 d = _mm256_sub_ps(one, _mm256_mask_i32gather_ps(zero, depthData, idx, inside, 4));
+
+		__m256 zd = _mm256_div_ps(nf2, _mm256_sub_ps(fpn, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(two, d), one), fmn)));
+		__m256 agree = _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(pz, zd), abs_mask), tol, _CMP_LT_OQ);
+		__m256 empty = _mm256_cmp_ps(d, one, _CMP_EQ_OQ);
+
+		int visible = _mm256_movemask_ps(_mm256_and_ps(inside, _mm256_or_ps(agree, empty)));
+		if (visible == 0)
+			continue;
+
+		_mm256_storeu_ps(xs, px);
+		_mm256_storeu_ps(ys, py);
+		for (int b = 0; b < 8; b++) {
+			if (visible & (1 << b)) {
+				u[count] = xs[b];
+				v[count] = ys[b];
+				ids[count] = indexed ? indices[i + b] : i + b;
+				count++;
+			}
+		}
+	}
+
+	return i;
+}
+#endif
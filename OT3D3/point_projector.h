@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+/**
+ *  Structure-of-arrays copy of a point set, the layout the vectorized projection
+ *  loads from.
+ */
+struct PointsSoA {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+
+	void assign(const std::vector<cv::Vec3f>& points);
+	int size() const { return (int)x.size(); }
+};
+
+/**
+ *  Projects model points into the image with a pinhole camera. The calibration and
+ *  the model-to-camera transformation are combined into one 3x4 matrix once, so every
+ *  point costs a single matrix-vector product. The batch functions on PointsSoA run
+ *  eight points at a time with AVX2 if the CPU supports it and fall back to scalar
+ *  code otherwise.
+ */
+class PointProjector {
+public:
+	/**
+	 *  @param K  The camera calibration matrix, of a view level the upper-left 3x3 block is used.
+	 *  @param T  The model to camera transformation, including any normalization.
+	 */
+	PointProjector(const cv::Matx33f& K, const cv::Matx44f& T);
+	PointProjector(const cv::Matx44f& K, const cv::Matx44f& T);
+
+	cv::Vec2f Project(const cv::Vec3f& point) const;
+
+	void Project(const std::vector<cv::Vec3f>& points, std::vector<cv::Vec2f>& image_points) const;
+
+	/**
+	 *  Projects the points [begin, end) to the image coordinates u, v and their camera
+	 *  depth z, all written at the point index.
+	 */
+	void Project(const PointsSoA& points, int begin, int end, float* u, float* v, float* z) const;
+
+	/**
+	 *  Projects the points [begin, end) and keeps those inside the depth buffer whose
+	 *  camera depth agrees with the rendered one within the tolerance, or that fall on
+	 *  a pixel without any rendered depth. The image coordinates and indices of the kept
+	 *  points are written consecutively starting at u, v and ids.
+	 *
+	 *  @param depth  The depth buffer (CV_32FC1) as read back from the view.
+	 *  @return  The number of kept points.
+	 */
+	int ProjectVisible(const PointsSoA& points, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids) const;
+
+	/**
+	 *  Same as above for the points indices[begin, end), the kept indices are written to ids.
+	 */
+	int ProjectVisible(const PointsSoA& points, const int* indices, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids) const;
+
+private:
+	template <bool indexed>
+	int ProjectVisibleBatch(const PointsSoA& points, const int* indices, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids) const;
+
+	// the AVX2 loops over batches of eight points, they return the first point left for the scalar loop
+	int ProjectAVX2(const PointsSoA& points, int begin, int end, float* u, float* v, float* z) const;
+	template <bool indexed>
+	int ProjectVisibleAVX2(const PointsSoA& points, const int* indices, int begin, int end, const cv::Mat& depth, float zNear, float zFar, float tolerance, float* u, float* v, int* ids, int& count) const;
+
+	// rows of K * T
+	float P[3][4];
+};
@@ -294,7 +294,7 @@ class PoseReaderKarl : public PoseReader {
 public:
 	virtual bool IsLostGT(const cv::Matx44f& gtm, const cv::Matx44f& tkm, const Object3D* object) override {
 		float max_dist = 0.0f;
-		for (auto x : object->vertices) {
+		for (auto x : object->getVertices()) {
 			cv::Vec4f dx = tkm * cv::Vec4f(x(0), x(1), x(2), 1) - gtm * cv::Vec4f(x(0), x(1), x(2), 1);
 			float norm2 = dx(0) * dx(0) + dx(1) * dx(1) + dx(2) * dx(2);
 			
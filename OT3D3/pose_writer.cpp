@@ -0,0 +1,50 @@
+#include <iomanip>
+
+#include "pose_writer.h"
+
+PoseWriter::PoseWriter(const std::string& file, const std::string& header, int num_objects) {
+	ofs.open(file);
+	if (!ofs.is_open())
+		return;
+
+	ofs << header << std::endl;
+	ofs << num_objects << std::endl;
+	ofs << std::setprecision(9);
+}
+
+PoseWriter::~PoseWriter() {
+	ofs.close();
+}
+
+void PoseWriter::Record(const cv::Matx44f& m, int fid) {
+	ofs << fid << ' '
+		<< m(0, 0) << ' ' << m(0, 1) << ' ' << m(0, 2) << ' '
+		<< m(1, 0) << ' ' << m(1, 1) << ' ' << m(1, 2) << ' '
+		<< m(2, 0) << ' ' << m(2, 1) << ' ' << m(2, 2) << ' '
+		<< m(0, 3) << ' ' << m(1, 3) << ' ' << m(2, 3) << '\n';
+}
+
+TimingWriter::TimingWriter(const std::string& file, const std::vector<std::string>& stages) {
+	ofs.open(file);
+	if (!ofs.is_open())
+		return;
+
+	ofs << "frame";
+	for (auto& stage : stages)
+		ofs << ',' << stage;
+	ofs << std::endl;
+
+	ofs.setf(std::ios_base::fixed, std::ios_base::floatfield);
+	ofs.precision(3);
+}
+
+TimingWriter::~TimingWriter() {
+	ofs.close();
+}
+
+void TimingWriter::Record(int fid, const std::vector<double>& times) {
+	ofs << fid;
+	for (double t : times)
+		ofs << ',' << t;
+	ofs << '\n';
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <opencv2/core.hpp>
+
+/**
+ *  Writes tracked poses in the RBOT text format: a header line, the number of
+ *  objects and one line "fid r00 r01 r02 r10 r11 r12 r20 r21 r22 t0 t1 t2" per
+ *  frame and object.
+ */
+class PoseWriter {
+public:
+	PoseWriter(const std::string& file, const std::string& header, int num_objects);
+	~PoseWriter();
+
+	bool IsOpen() const { return ofs.is_open(); }
+
+	void Record(const cv::Matx44f& m, int fid);
+
+protected:
+	std::ofstream ofs;
+};
+
+/**
+ *  Writes per-frame timings as CSV with one column per stage in milliseconds.
+ */
+class TimingWriter {
+public:
+	TimingWriter(const std::string& file, const std::vector<std::string>& stages);
+	~TimingWriter();
+
+	bool IsOpen() const { return ofs.is_open(); }
+
+	void Record(int fid, const std::vector<double>& times);
+
+protected:
+	std::ofstream ofs;
+};
@@ -0,0 +1,561 @@
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+#include "view.h"
+#include "relocalizer.h"
+#include "thread_pool.h"
+#include "cpu_features.h"
+#include "global_params.h"
+#include "template_view.h"
+#include "tclc_histograms.h"
+
+// the template pyramid levels used for the coarse search over the whole frame and for the refinement
+static const int kCoarseLevel = 3;
+static const int kFineLevel = 2;
+
+// offset grid step of the coarse search and search radius of the refinement (in pixels of their levels)
+static const int kCoarseStep = 2;
+static const int kFineRadius = 2;
+
+// the number of grid rows of a template's window that one task of the coarse search scans,
+// so the deadline and cancellation are checked several times per template
+static const int kCoarseBandRows = 8;
+
+// the number of horizontal offsets scored in one pass over the template pixels
+static const int kScoreLanes = 8;
+
+// the number of template pixels between two checks whether the offsets can still reach the required score
+static const int kBoundInterval = 32;
+
+// a match is at best as good as chance below this score, the template is not considered further
+static const float kHopelessScore = 0.5f;
+
+namespace {
+
+/**
+ *  The binned frame at one pyramid level and the tclc-histograms to look up the
+ *  pixel-wise posteriors in. The rows of the bins are padded by one element, so
+ *  they can be gathered with 32 bit loads.
+ */
+struct MatchInput {
+	cv::Mat bins;
+	int stride;
+
+	const float* fg;
+	const float* bg;
+	const uchar* initialized;
+	int histogramSize;
+	bool gather;	// the offsets are scored with AVX2 gathers
+};
+
+/**
+ *  A template matched within a range of 2D offsets, and the best offset found.
+ *  The step grid is scanned in the given rows of the window only, the refinement
+ *  around the best offset may extend to the whole window.
+ */
+struct MatchTask {
+	TemplateView* kv;
+	int level;
+	cv::Rect window;
+	cv::Range rows;
+	int step;
+
+	int x, y;
+	float score;
+};
+
+/**
+ *  The template pixels that lie within an initialized histogram at one level,
+ *  prepared for a frame. The per pixel energy hs * ppf + (1 - hs) * (1 - ppf)
+ *  with ppf = sum / n becomes a + b * sum, where sum adds up the posteriors of
+ *  the pixel's histograms.
+ */
+struct MatchPlan {
+	std::vector<int> pixels;
+	std::vector<float> a, b;
+	std::vector<int> offsets;
+	std::vector<int> ids;
+
+	int size() const { return (int)pixels.size(); }
+
+	void build(const MatchInput& input, const CompressedPixelData& pixelData, const cv::Rect& roi) {
+		pixels.clear();
+		a.clear();
+		b.clear();
+		ids.clear();
+		offsets.assign(1, 0);
+
+		for (int i = 0; i < pixelData.size(); i++) {
+			int n = 0;
+			for (int k = pixelData.offsets[i]; k < pixelData.offsets[i + 1]; k++) {
+				int id = pixelData.getId(k);
+				if (!input.initialized[id])
+					continue;
+
+				ids.push_back(id);
+				n++;
+			}
+			if (n == 0)
+				continue;
+
+			float hs = pixelData.getHsVal(i);
+			pixels.push_back((roi.y + pixelData.y[i]) * input.stride + roi.x + pixelData.x[i]);
+			a.push_back(1.0f - hs);
+			b.push_back((2.0f * hs - 1.0f) / n);
+			offsets.push_back((int)ids.size());
+		}
+	}
+};
+
+}
+
+/**
+ *  The mean probability of the template's Heaviside values at one 2D offset, given
+ *  as an offset into the bins. Stops early with a negative score once the offset
+ *  can no longer reach the minimum score, as every remaining pixel adds at most 1.
+ */
+static float ScoreOffset(const MatchInput& input, const MatchPlan& plan, int offset, float minScore) {
+	const ushort* bins = input.bins.ptr<ushort>() + offset;
+
+	int count = plan.size();
+	float required = minScore * count;
+	float sum = 0.0f;
+
+	for (int i = 0; i < count; i++) {
+		int bin = bins[plan.pixels[i]];
+
+		float ppf = 0.0f;
+		for (int k = plan.offsets[i]; k < plan.offsets[i + 1]; k++) {
+			size_t row = (size_t)plan.ids[k] * input.histogramSize;
+			float pf = input.fg[row + bin] + 0.0000001f;
+			float pb = input.bg[row + bin] + 0.0000001f;
+			ppf += pf / (pf + pb);
+		}
+		sum += plan.a[i] + plan.b[i] * ppf;
+
+		if ((i + 1) % kBoundInterval == 0 && sum + (count - i - 1) < required)
+			return -1.0f;
+	}
+
+	return sum >= required ? sum / count : -1.0f;
+}
+
+#ifdef OT3D_AVX2
+/**
+ *  Scores up to kScoreLanes offsets that are step pixels apart within a row in one
+ *  pass over the template pixels, with one lane per offset. The bins and the
+ *  posteriors of all lanes are gathered at once. Stops early once no lane can
+ *  reach the minimum score anymore.
+ */
+static OT3D_TARGET_AVX2 void ScoreOffsetsAVX2(const MatchInput& input, const MatchPlan& plan, int offset, int step, int lanes, float minScore, float* scores) {
+	const int* bins = (const int*)(input.bins.ptr<ushort>() + offset);
+
+	// unused lanes repeat the first offset
+	__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i active = _mm256_cmpgt_epi32(_mm256_set1_epi32(lanes), lane);
+	__m256i laneOffsets = _mm256_and_si256(_mm256_mullo_epi32(lane, _mm256_set1_epi32(step)), active);
+
+	const __m256i binMask = _mm256_set1_epi32(0xFFFF);
+	const __m256 eps = _mm256_set1_ps(0.0000001f);
+
+	int count = plan.size();
+	float required = minScore * count;
+	__m256 sum = _mm256_setzero_ps();
+
+	for (int i = 0; i < count; i++) {
+		// each lane reads its 16 bit bin and the next one, which the padding of the rows keeps within the image
+		__m256i index = _mm256_add_epi32(_mm256_set1_epi32(plan.pixels[i]), laneOffsets);
+		__m256i bin = _mm256_and_si256(_mm256_i32gather_epi32(bins, index, 2), binMask);
+
+		__m256 ppf = _mm256_setzero_ps();
+		for (int k = plan.offsets[i]; k < plan.offsets[i + 1]; k++) {
+			__m256i entry = _mm256_add_epi32(bin, _mm256_set1_epi32(plan.ids[k] * input.histogramSize));
+			__m256 pf = _mm256_add_ps(_mm256_i32gather_ps(input.fg, entry, 4), eps);
+			__m256 pb = _mm256_add_ps(_mm256_i32gather_ps(input.bg, entry, 4), eps);
+			ppf = _mm256_add_ps(ppf, _mm256_div_ps(pf, _mm256_add_ps(pf, pb)));
+		}
+		sum = _mm256_add_ps(sum, _mm256_add_ps(_mm256_set1_ps(plan.a[i]), _mm256_mul_ps(_mm256_set1_ps(plan.b[i]), ppf)));
+
+		if ((i + 1) % kBoundInterval == 0) {
+			__m256 best = _mm256_max_ps(sum, _mm256_permute2f128_ps(sum, sum, 1));
+			best = _mm256_max_ps(best, _mm256_shuffle_ps(best, best, _MM_SHUFFLE(1, 0, 3, 2)));
+			best = _mm256_max_ps(best, _mm256_shuffle_ps(best, best, _MM_SHUFFLE(2, 3, 0, 1)));
+			if (_mm256_cvtss_f32(best) + (count - i - 1) < required) {
+				for (int l = 0; l < lanes; l++) {
+					scores[l] = -1.0f;
+				}
+				return;
+			}
+		}
+	}
+
+	float sums[kScoreLanes];
+	_mm256_storeu_ps(sums, sum);
+	for (int l = 0; l < lanes; l++) {
+		scores[l] = sums[l] >= required ? sums[l] / count : -1.0f;
+	}
+}
+#endif
+
+/**
+ *  Scores the offsets x0, x0 + step, ... below x1 in row oy and keeps the best
+ *  one in the task. Only offsets that beat the best score so far are evaluated
+ *  to the end.
+ */
+static void MatchRow(const MatchInput& input, const MatchPlan& plan, MatchTask& task, int oy, int x0, int x1, int step, float minScore) {
+	float scores[kScoreLanes];
+
+	for (int ox = x0; ox < x1; ox += kScoreLanes * step) {
+		int lanes = std::min(kScoreLanes, (x1 - ox + step - 1) / step);
+		int offset = oy * input.stride + ox;
+		float required = std::max(minScore, task.score);
+
+#ifdef OT3D_AVX2
+		if (input.gather) {
+			ScoreOffsetsAVX2(input, plan, offset, step, lanes, required, scores);
+		}
+		else
+#endif
+		{
+			for (int l = 0; l < lanes; l++) {
+				scores[l] = ScoreOffset(input, plan, offset + l * step, required);
+			}
+		}
+
+		for (int l = 0; l < lanes; l++) {
+			if (scores[l] > task.score) {
+				task.score = scores[l];
+				task.x = ox + l * step;
+				task.y = oy;
+			}
+		}
+	}
+}
+
+/**
+ *  Matches every task's template at all offsets of its rows on the step grid,
+ *  then around the best one with a step of 1. Tasks that start after the deadline
+ *  or after a cancellation, and templates that score below the minimum score at
+ *  every offset are skipped with a negative score.
+ */
+class Parallel_For_matchTemplates : public cv::ParallelLoopBody
+{
+private:
+	const MatchInput* _inputs;
+	MatchTask* _tasks;
+
+	float _minScore;
+	int64 _deadline;
+	const std::atomic<bool>* _cancel;
+
+public:
+	Parallel_For_matchTemplates(const MatchInput* inputs, std::vector<MatchTask>& tasks, float minScore, int64 deadline, const std::atomic<bool>* cancel)
+		: _inputs(inputs), _tasks(tasks.data()), _minScore(minScore), _deadline(deadline), _cancel(cancel)
+	{
+	}
+
+	virtual void operator()(const cv::Range& r) const
+	{
+		MatchPlan plan;
+
+		for (int t = r.start; t < r.end; t++) {
+			MatchTask& task = _tasks[t];
+			task.score = -1.0f;
+
+			if (cv::getTickCount() > _deadline || (_cancel && *_cancel))
+				continue;
+
+			const MatchInput& input = _inputs[task.level];
+			if (task.window.width <= 0 || task.rows.start >= task.rows.end)
+				continue;
+
+			plan.build(input, task.kv->getCompressedPixelData(task.level), task.kv->getROI(task.level));
+			if (plan.size() == 0)
+				continue;
+
+			for (int oy = task.rows.start; oy < task.rows.end; oy += task.step) {
+				MatchRow(input, plan, task, oy, task.window.x, task.window.x + task.window.width, task.step, _minScore);
+			}
+
+			if (task.step <= 1 || task.score < 0.0f)
+				continue;
+
+			int cx = task.x, cy = task.y;
+			int x0 = std::max(cx - task.step + 1, task.window.x);
+			int x1 = std::min(cx + task.step, task.window.x + task.window.width);
+			int y0 = std::max(cy - task.step + 1, task.window.y);
+			int y1 = std::min(cy + task.step, task.window.y + task.window.height);
+			for (int oy = y0; oy < y1; oy++) {
+				MatchRow(input, plan, task, oy, x0, x1, 1, _minScore);
+			}
+		}
+	}
+};
+
+/**
+ *  The offsets at which the template ROI lies within the frame at its level,
+ *  intersected with the given window.
+ */
+static cv::Rect ClampWindow(TemplateView* kv, int level, const cv::Size& size, const cv::Rect& window) {
+	cv::Rect roi = kv->getROI(level);
+	cv::Rect valid(-roi.x, -roi.y, size.width - roi.width + 1, size.height - roi.height + 1);
+	return valid & window;
+}
+
+static bool CompareScore(const MatchTask& a, const MatchTask& b) {
+	return a.score > b.score;
+}
+
+Relocalizer::Relocalizer(const std::vector<Object3D*>& objects) {
+	this->objects = objects;
+	for (int i = 0; i < objects.size(); i++) {
+		jobs.emplace_back(new Job());
+		jobs.back()->state = Job::IDLE;
+		jobs.back()->cancel = false;
+	}
+
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+	budget = gp->relocalizationBudget;
+
+	stop = false;
+	next_job = 0;
+	worker = std::thread(&Relocalizer::WorkerLoop, this);
+}
+
+Relocalizer::~Relocalizer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+		for (auto& job : jobs) {
+			job->cancel = true;
+		}
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+int Relocalizer::Update(const cv::Mat& frame) {
+	int found = 0;
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int i = 0; i < objects.size(); i++) {
+			Job& job = *jobs[i];
+
+			if (job.state == Job::FOUND) {
+				// the tracker may have recovered the object by itself in the meantime
+				if (objects[i]->isTrackingLost()) {
+					objects[i]->setPose(job.pose);
+					objects[i]->setPrePose(job.pose);
+					objects[i]->setTrackingLost(false);
+					found++;
+				}
+				job.state = Job::IDLE;
+			}
+			else if (job.state == Job::FAILED) {
+				// try again in this frame
+				job.state = Job::IDLE;
+			}
+
+			if (job.state == Job::IDLE && objects[i]->isTrackingLost() && !objects[i]->getTemplateViews().empty()) {
+				job.frame = frame.clone();
+				job.cancel = false;
+				job.state = Job::QUEUED;
+				queued = true;
+			}
+		}
+	}
+	if (queued)
+		wake.notify_all();
+
+	return found;
+}
+
+void Relocalizer::Cancel(int objectIndex) {
+	if (objectIndex < 0 || objectIndex >= jobs.size())
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	Job& job = *jobs[objectIndex];
+	job.cancel = true;
+	idle.wait(lock, [&job] { return job.state != Job::RUNNING; });
+	job.state = Job::IDLE;
+	job.frame.release();
+}
+
+bool Relocalizer::IsSearching(int objectIndex) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Job::State state = jobs[objectIndex]->state;
+	return state == Job::QUEUED || state == Job::RUNNING;
+}
+
+void Relocalizer::WorkerLoop() {
+	while (true) {
+		int index = -1;
+		cv::Mat frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] {
+				if (stop)
+					return true;
+				for (auto& job : jobs) {
+					if (job->state == Job::QUEUED)
+						return true;
+				}
+				return false;
+			});
+			if (stop)
+				return;
+
+			// round robin, so one object that is never found does not starve the others
+			for (int i = 0; i < jobs.size() && index < 0; i++) {
+				int j = (next_job + i) % jobs.size();
+				if (jobs[j]->state == Job::QUEUED)
+					index = j;
+			}
+			next_job = (index + 1) % jobs.size();
+
+			jobs[index]->state = Job::RUNNING;
+			frame = jobs[index]->frame;
+			jobs[index]->frame.release();
+		}
+
+		Job& job = *jobs[index];
+		cv::Matx44f pose;
+		float score = Detect(objects[index], frame, budget, pose, &job.cancel);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (job.cancel) {
+				job.state = Job::IDLE;
+			}
+			else if (score >= objects[index]->getQualityThreshold()) {
+				job.pose = pose;
+				job.state = Job::FOUND;
+			}
+			else {
+				job.state = Job::FAILED;
+			}
+		}
+		idle.notify_all();
+	}
+}
+
+float Relocalizer::Detect(Object3D* object, const cv::Mat& frame, double budget, cv::Matx44f& pose, const std::atomic<bool>* cancel) {
+	std::vector<TemplateView*> baseTemplates = object->getTemplateViews();
+	TCLCHistograms* tclcHistograms = object->getTCLCHistograms();
+	if (baseTemplates.empty() || tclcHistograms == NULL || frame.type() != CV_8UC3)
+		return -1.0f;
+
+	int64 deadline = cv::getTickCount() + int64(budget * 1e-3 * cv::getTickFrequency());
+
+	cv::Mat localFG = tclcHistograms->getLocalForegroundHistograms();
+	cv::Mat localBG = tclcHistograms->getLocalBackgroundHistograms();
+	cv::Mat initialized = tclcHistograms->getInitialized();
+
+	int numBins = tclcHistograms->getNumBins();
+	int binShift = 8 - log(numBins) / log(2);
+
+	// the histogram bin of every pixel at the two matching levels
+	MatchInput inputs[kCoarseLevel + 1];
+	for (int level = kFineLevel; level <= kCoarseLevel; level++) {
+		cv::Mat image;
+		int scale = 1 << level;
+		cv::resize(frame, image, cv::Size(frame.cols / scale, frame.rows / scale));
+
+		MatchInput& input = inputs[level];
+		input.bins = cv::Mat(image.rows, image.cols + 1, CV_16UC1, cv::Scalar(0)).colRange(0, image.cols);
+		input.stride = (int)input.bins.step1();
+		for (int y = 0; y < image.rows; y++) {
+			const uchar* src = image.ptr<uchar>(y);
+			ushort* dst = input.bins.ptr<ushort>(y);
+			for (int x = 0; x < image.cols; x++, src += 3) {
+				dst[x] = (ushort)((((src[0] >> binShift) * numBins) + (src[1] >> binShift)) * numBins + (src[2] >> binShift));
+			}
+		}
+
+		input.fg = localFG.ptr<float>();
+		input.bg = localBG.ptr<float>();
+		input.initialized = initialized.ptr<uchar>();
+		input.histogramSize = localFG.cols;
+
+		// the gathers address the posterior tables with 32 bit offsets
+		input.gather = HasAVX2() && (double)localFG.rows * localFG.cols <= INT_MAX;
+	}
+
+	// templates that cannot reach the quality threshold are not candidates either
+	float minScore = std::min(kHopelessScore, object->getQualityThreshold());
+
+	cv::Size coarseSize = inputs[kCoarseLevel].bins.size();
+	cv::Size fineSize = inputs[kFineLevel].bins.size();
+
+	// all base templates over the whole frame at the coarse level, in bands of rows
+	std::vector<MatchTask> bandTasks;
+	for (auto kv : baseTemplates) {
+		MatchTask task;
+		task.kv = kv;
+		task.level = kCoarseLevel;
+		task.window = ClampWindow(kv, kCoarseLevel, coarseSize, cv::Rect(-coarseSize.width, -coarseSize.height, 2 * coarseSize.width, 2 * coarseSize.height));
+		task.step = kCoarseStep;
+
+		int end = task.window.y + std::max(task.window.height, 0);
+		for (int y = task.window.y; y < end; y += kCoarseBandRows * kCoarseStep) {
+			task.rows = cv::Range(y, std::min(y + kCoarseBandRows * kCoarseStep, end));
+			bandTasks.push_back(task);
+		}
+	}
+	ThreadPool::Instance()->ParallelForBackground(cv::Range(0, (int)bandTasks.size()), Parallel_For_matchTemplates(inputs, bandTasks, minScore, deadline, cancel));
+
+	// the best band of every template, the bands of one template are adjacent
+	std::vector<MatchTask> coarseTasks;
+	for (const MatchTask& task : bandTasks) {
+		if (!coarseTasks.empty() && coarseTasks.back().kv == task.kv) {
+			if (task.score > coarseTasks.back().score)
+				coarseTasks.back() = task;
+		}
+		else {
+			coarseTasks.push_back(task);
+		}
+	}
+
+	std::sort(coarseTasks.begin(), coarseTasks.end(), CompareScore);
+	if (coarseTasks.empty() || coarseTasks[0].score < 0.0f)
+		return -1.0f;
+
+	// the best candidates and their neighbors around the found offsets at the fine level
+	int numCandidates = std::min(OT3D::GlobalParam::Instance()->relocalizationCandidates, (int)coarseTasks.size());
+	std::vector<MatchTask> fineTasks;
+	for (int c = 0; c < numCandidates && coarseTasks[c].score >= 0.0f; c++) {
+		const MatchTask& candidate = coarseTasks[c];
+		int scale = 1 << (kCoarseLevel - kFineLevel);
+		cv::Rect window(candidate.x * scale - kFineRadius, candidate.y * scale - kFineRadius, 2 * kFineRadius + 1, 2 * kFineRadius + 1);
+
+		std::vector<TemplateView*> views = candidate.kv->getNeighborTemplates();
+		views.insert(views.begin(), candidate.kv);
+		for (auto kv : views) {
+			MatchTask task;
+			task.kv = kv;
+			task.level = kFineLevel;
+			task.window = ClampWindow(kv, kFineLevel, fineSize, window);
+			task.rows = cv::Range(task.window.y, task.window.y + std::max(task.window.height, 0));
+			task.step = 1;
+			fineTasks.push_back(task);
+		}
+	}
+	ThreadPool::Instance()->ParallelForBackground(cv::Range(0, (int)fineTasks.size()), Parallel_For_matchTemplates(inputs, fineTasks, minScore, deadline, cancel));
+
+	std::sort(fineTasks.begin(), fineTasks.end(), CompareScore);
+	const MatchTask& best = (!fineTasks.empty() && fineTasks[0].score >= 0.0f) ? fineTasks[0] : coarseTasks[0];
+
+	// shift the template pose by the 2D offset at its distance
+	cv::Matx44f K = View::Instance()->GetCalibrationMatrix(0);
+	float scale = float(1 << best.level);
+	pose = best.kv->getPoseMatrix();
+	pose(0, 3) += best.x * scale * pose(2, 3) / K(0, 0);
+	pose(1, 3) += best.y * scale * pose(2, 3) / K(1, 1);
+
+	return best.score;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "object3d.h"
+
+class TemplateView;
+
+/**
+ *  Template-based pose detection for objects whose tracking has been lost. All
+ *  base templates are matched at the coarsest template pyramid level over a grid
+ *  of 2D offsets covering the frame. The best candidates and their neighboring
+ *  templates are then matched around the found offsets at the next finer level.
+ *  A match is scored by the mean probability of the template's Heaviside values
+ *  under the pixel-wise posteriors of the tclc-histograms the template pixels lie
+ *  within, which is in [0, 1] and accepted above the quality threshold of the
+ *  object. The offsets of a row are scored together, one per vector lane, and
+ *  offsets that can no longer beat the best one so far are abandoned early.
+ *  Templates that do not score above chance anywhere are no candidates.
+ *
+ *  The searches run on a background thread, one object at a time, and spread
+ *  the template matching over the kernel thread pool in small tasks, so the
+ *  tracking loop keeps its frame rate. The histograms of a lost object must not
+ *  be updated or cleared while it is searched for, see Cancel().
+ */
+class Relocalizer {
+public:
+	/**
+	 *  Starts the background thread. The templates of the objects must have been
+	 *  generated before they can be found.
+	 */
+	Relocalizer(const std::vector<Object3D*>& objects);
+	~Relocalizer();
+
+	/**
+	 *  Hands the poses found since the last call to their objects that are still
+	 *  lost, which are then no longer lost, and starts a search in the frame for every lost object that
+	 *  is not searched for yet. Must be called from the thread that runs the tracker.
+	 *
+	 *  @param  frame The current undistorted camera frame, it is copied.
+	 *  @return The number of objects that have been relocalized.
+	 */
+	int Update(const cv::Mat& frame);
+
+	/**
+	 *  Abandons the search for an object and returns once the background thread
+	 *  no longer uses it. Must be called before the object is reset.
+	 *
+	 *  @param  objectIndex The index of the object.
+	 */
+	void Cancel(int objectIndex);
+
+	bool IsSearching(int objectIndex);
+
+	/**
+	 *  Searches the templates of an object in a frame. The calling thread waits while the
+	 *  background workers of the thread pool match them.
+	 *
+	 *  @param  object The object, its templates and histograms are only read.
+	 *  @param  frame The camera frame.
+	 *  @param  budget The time after which no further parts of the search are started (in ms).
+	 *  @param  pose Set to the pose of the best match.
+	 *  @param  cancel A flag that stops the search early when set.
+	 *  @return The score of the best match in [0, 1], negative if nothing could be matched.
+	 */
+	static float Detect(Object3D* object, const cv::Mat& frame, double budget, cv::Matx44f& pose, const std::atomic<bool>* cancel = NULL);
+
+protected:
+	struct Job {
+		enum State { IDLE, QUEUED, RUNNING, FOUND, FAILED };
+
+		State state;
+		cv::Mat frame;
+		cv::Matx44f pose;
+		std::atomic<bool> cancel;
+	};
+
+	void WorkerLoop();
+
+	std::vector<Object3D*> objects;
+	std::vector<std::unique_ptr<Job> > jobs;
+
+	double budget;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	bool stop;
+	int next_job;
+
+	std::thread worker;
+};
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 
 #include <glog/logging.h>
 #include <opencv2/core.hpp>
@@ -65,6 +66,7 @@ void SearchLine::FindSearchLine(const cv::Mat& mask, const cv::Mat& frame, int l
 	search_points.clear();
 	norms.clear();
 	actives.clear();
+	point_ids.clear();
 
 	for (int j = 0; j < contours.size(); ++j) {
 		if (contours[j].size() < 20)
@@ -129,6 +131,55 @@ static bool PtInFrame(const cv::Point& pt, int width, int height) {
 	return (pt.x < width && pt.y < height && pt.x >= 0 && pt.y >= 0);
 }
 
+void SearchLine::FindSearchLine(const std::vector<cv::Point2f>& points, const std::vector<cv::Point2f>& normals, const cv::Mat& frame, int line_len) {
+	contours.clear();
+	search_points.clear();
+	norms.clear();
+	actives.clear();
+	point_ids.clear();
+
+	int width = frame.cols;
+	int height = frame.rows;
+
+	for (int i = 0; i < points.size(); ++i) {
+		cv::Point center(cvRound(points[i].x), cvRound(points[i].y));
+		if (center.x <= 0 || center.x >= width - 1 || center.y <= 0 || center.y >= height - 1)
+			continue;
+
+		cv::Point2f norm = normals[i];
+
+		// unit steps along the major axis of the normal, as for the rasterized lines
+		float major = std::max(fabs(norm.x), fabs(norm.y));
+		if (major < 1e-6f)
+			continue;
+		cv::Point2f step = norm / major;
+
+		// outside to inside, followed by (index of the center, matched index)
+		std::vector<cv::Point> sl;
+		for (int k = line_len; k >= 1; k--) {
+			cv::Point pt(cvRound(center.x + k * step.x), cvRound(center.y + k * step.y));
+			if (PtInFrame(pt, width, height))
+				sl.push_back(pt);
+		}
+
+		int mid = (int)sl.size();
+		sl.push_back(center);
+
+		for (int k = 1; k <= line_len; k++) {
+			cv::Point pt(cvRound(center.x - k * step.x), cvRound(center.y - k * step.y));
+			if (PtInFrame(pt, width, height))
+				sl.push_back(pt);
+		}
+
+		sl.push_back(cv::Point(mid, 0));
+
+		search_points.push_back(sl);
+		norms.push_back(norm);
+		actives.push_back(1);
+		point_ids.push_back(i);
+	}
+}
+
 void SearchLine::getLine(float k, const cv::Point& center, int line_len, const cv::Mat& fill_img, std::vector<cv::Point>& points, cv::Point2f& norm) {
 	static std::vector<cv::Point> decrease;
 	static std::vector<cv::Point> increase;
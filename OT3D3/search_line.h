@@ -6,6 +6,8 @@ public:
 	virtual ~SearchLine() {}
 
 	void FindSearchLine(const cv::Mat& mask, const cv::Mat& frame, int len, int seg, bool use_all);
+	// search lines along given contour points and outward unit normals, without a rendered mask
+	void FindSearchLine(const std::vector<cv::Point2f>& points, const std::vector<cv::Point2f>& normals, const cv::Mat& frame, int len);
 	void DrawSearchLine(cv::Mat& line_mask) const;
 	void DrawContours(cv::Mat& contour_mask) const;
 
@@ -14,6 +16,7 @@ public:
 	std::vector<std::vector<cv::Point2f> > bundle_prob;
 	std::vector<uchar> actives;
 	std::vector<cv::Point2f> norms;
+	std::vector<int> point_ids;	// index of the input point of each search line, point based search lines only
 
 protected:
 	void getLine(float k, const cv::Point& center, int len, const cv::Mat& mask, std::vector<cv::Point>& search_points, cv::Point2f& norm);
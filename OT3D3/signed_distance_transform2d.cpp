@@ -1,4 +1,5 @@
 #include "signed_distance_transform2d.h"
+#include "thread_pool.h"
 
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -19,19 +20,106 @@ SignedDistanceTransform2D::~SignedDistanceTransform2D()
 
 void SignedDistanceTransform2D::computeTransform(const Mat &src, Mat &sdt, Mat &xyPos, int threads, uchar key)
 {
-    sdt.create(src.size(), CV_32FC1);
-    Mat dd(src.size(), CV_32SC1);
-    Mat xPos(src.size(), CV_32SC1);
     xyPos.create(src.size(), CV_32SC2);
     
+    transform(src, sdt, xyPos, threads, key);
+}
+
+
+void SignedDistanceTransform2D::computeNarrowBand(const Mat &src, const Rect &roi, Mat &sdt, Mat *xyPos, int threads, uchar key)
+{
+    float outside = maxDist + 1.0f;
+    
+    sdt.create(src.size(), CV_32FC1);
+    sdt.setTo(outside);
+    if(xyPos)
+    {
+        xyPos->create(src.size(), CV_32SC2);
+        xyPos->setTo(-1);
+    }
+    
+    Rect band = roi & Rect(0, 0, src.cols, src.rows);
+    if(band.area() == 0)
+        return;
+    
+    // contour points up to the maximum distance beyond the ROI still count
+    int margin = (int)ceil(maxDist) + 1;
+    Rect window = Rect(band.x - margin, band.y - margin, band.width + 2*margin, band.height + 2*margin) & Rect(0, 0, src.cols, src.rows);
+    
+    // the input is only referenced for this call, the copy is kept
+    Mat windowSrc = src;
+    if(window.size() != src.size() || !src.isContinuous())
+    {
+        src(window).copyTo(bandSrc);
+        windowSrc = bandSrc;
+    }
+    
+    if(xyPos)
+    {
+        bandXYPos.create(window.size(), CV_32SC2);
+    }
+    else
+    {
+        bandXYPos.release();
+    }
+    
+    transform(windowSrc, bandSdt, bandXYPos, threads, key);
+    
+    for(int y = band.y; y < band.y + band.height; y++)
+    {
+        const float *bandRow = bandSdt.ptr<float>(y - window.y) + band.x - window.x;
+        float *sdtRow = sdt.ptr<float>(y) + band.x;
+        
+        for(int x = 0; x < band.width; x++)
+        {
+            float ds = bandRow[x];
+            sdtRow[x] = (fabs(ds) <= maxDist) ? ds : (ds > 0 ? outside : -outside);
+        }
+        
+        if(xyPos)
+        {
+            const Vec2i *bandPos = bandXYPos.ptr<Vec2i>(y - window.y) + band.x - window.x;
+            Vec2i *pos = xyPos->ptr<Vec2i>(y) + band.x;
+            
+            for(int x = 0; x < band.width; x++)
+            {
+                if(fabs(sdtRow[x]) <= maxDist && bandPos[x][0] >= 0)
+                {
+                    pos[x] = Vec2i(bandPos[x][0] + window.x, bandPos[x][1] + window.y);
+                }
+            }
+        }
+    }
+}
+
+
+void SignedDistanceTransform2D::transform(const Mat &src, Mat &sdt, Mat &xyPos, int threads, uchar key)
+{
+    sdt.create(src.size(), CV_32FC1);
+    dd.create(src.size(), CV_32SC1);
+    
     sdt.setTo(0);
-    xyPos.setTo(-1);
+    if(!xyPos.empty())
+    {
+        xPos.create(src.size(), CV_32SC1);
+        xyPos.setTo(-1);
+    }
     
     int n = (src.cols > src.rows) ? src.cols : src.rows;
     
-    int* v = (int *)malloc(threads*n*sizeof(int));
-    int* z = (int *)malloc(threads*(n+1)*sizeof(int));
-    int* f = (int *)malloc(threads*n*sizeof(int));
+    ThreadPool* pool = ThreadPool::Instance();
+    int rowChunks = (threads > 0) ? threads : pool->NumChunks(src.rows);
+    int colChunks = (threads > 0) ? threads : pool->NumChunks(src.cols);
+    
+    // one set of scratch buffers per chunk
+    threads = max(rowChunks, colChunks);
+    
+    v.resize(max(v.size(), (size_t)threads*n));
+    z.resize(max(z.size(), (size_t)threads*(n+1)));
+    f.resize(max(f.size(), (size_t)threads*n));
+    
+    // the closest contour points are only traced back through the rows if requested
+    Mat rowPos = xyPos.empty() ? Mat() : xPos;
     
     int type = src.type();
     uchar depth = type & CV_MAT_DEPTH_MASK;
@@ -40,28 +128,23 @@ void SignedDistanceTransform2D::computeTransform(const Mat &src, Mat &sdt, Mat &
     {
         if(key > 0)
         {
-            parallel_for_(cv::Range(0, threads), Parallel_For_distanceTransformRowsWithKey(src, key, dd, xPos, v, z, threads));
+            pool->ParallelFor(cv::Range(0, rowChunks), Parallel_For_distanceTransformRowsWithKey(src, key, dd, rowPos, v.data(), z.data(), rowChunks));
         }
         else
         {
-            parallel_for_(cv::Range(0, threads), Parallel_For_distanceTransformRows<uchar>(src, dd, xPos, v, z, threads));
+            pool->ParallelFor(cv::Range(0, rowChunks), Parallel_For_distanceTransformRows<uchar>(src, dd, rowPos, v.data(), z.data(), rowChunks));
         }
     }
     else if(depth == CV_32F)
     {
-        parallel_for_(cv::Range(0, threads), Parallel_For_distanceTransformRows<float>(src, dd, xPos, v, z, threads));
+        pool->ParallelFor(cv::Range(0, rowChunks), Parallel_For_distanceTransformRows<float>(src, dd, rowPos, v.data(), z.data(), rowChunks));
     }
     else
     {
         cout << "WRONG IMAGE TYPE FOR SIGNED DISTANCE TRANSFORMATION! NOTE: USE FLOAT OR UCHAR." << endl;
     }
     
-    parallel_for_(cv::Range(0, threads), Parallel_For_distanceTransformCols(dd, sdt, xPos, xyPos, maxDist, v, z, f, threads));
-    
-    
-    free(z);
-    free(v);
-    free(f);
+    pool->ParallelFor(cv::Range(0, colChunks), Parallel_For_distanceTransformCols(dd, sdt, rowPos, xyPos, maxDist, v.data(), z.data(), f.data(), colChunks));
 }
 
 
@@ -76,6 +159,12 @@ void SignedDistanceTransform2D::computeDerivatives(const cv::Mat &sdt, cv::Mat &
     dY.row(0).setTo(0);
     dY.row(dY.rows-1).setTo(0);
     
-    parallel_for_(cv::Range(0, threads), Parallel_For_distanceTransformDX<float>(sdt, dX, threads));
-    parallel_for_(cv::Range(0, threads), Parallel_For_distanceTransformDY<float>(sdt, dY, threads));
+    ThreadPool* pool = ThreadPool::Instance();
+    if(threads <= 0)
+    {
+        threads = pool->NumChunks(sdt.rows);
+    }
+    
+    pool->ParallelFor(cv::Range(0, threads), Parallel_For_distanceTransformDX<float>(sdt, dX, threads));
+    pool->ParallelFor(cv::Range(0, threads), Parallel_For_distanceTransformDY<float>(sdt, dY, threads));
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 #include <emmintrin.h>
 
@@ -39,11 +40,28 @@ public:
      *  @param  src The input image of which the distance transform shall be computed (single channel, float of uchar).
      *  @param  sdt The output 2D Euclidean signed distance transform of src.
      *  @param  xyPos The per pixel 2D coordinates of the closest contour points (two channel, integer).
-     *  @param  threads The number of threads to be used for parallelization.
+     *  @param  threads The number of work chunks the rows and columns are split into for the thread pool (0 = chosen from the pool size).
      *  @param  key In case of a uchar input image that is not binary, the value specidfies the intensitiy to be considered foregorund (default = 0, i.e. anything not equal to 0 is considered foreground).
      */
     void computeTransform(const cv::Mat &src, cv::Mat &sdt, cv::Mat &xyPos, int threads, uchar key = 0);
     
+    /**
+     *  Computes the 2D Euclidean signed distance transform of a given input image only
+     *  within a region of interest and only up to the maximum distance. The transform
+     *  runs on the ROI extended by the maximum distance, so the distances within the
+     *  band around the contour are the same as those of the full transform. Farther
+     *  pixels within the ROI are set to +-(maximum distance + 1) depending on their
+     *  side of the contour, the pixels outside of the ROI to maximum distance + 1.
+     *
+     *  @param  src The input image of which the distance transform shall be computed (single channel, float of uchar).
+     *  @param  roi The region of interest within src.
+     *  @param  sdt The output 2D Euclidean signed distance transform of src.
+     *  @param  xyPos The per pixel 2D coordinates of the closest contour points within the band (two channel, integer, -1 elsewhere and where a row of the extended ROI has no contour point), not computed if NULL.
+     *  @param  threads The number of work chunks the rows and columns are split into for the thread pool (0 = chosen from the pool size).
+     *  @param  key In case of a uchar input image that is not binary, the value specidfies the intensitiy to be considered foregorund (default = 0, i.e. anything not equal to 0 is considered foreground).
+     */
+    void computeNarrowBand(const cv::Mat &src, const cv::Rect &roi, cv::Mat &sdt, cv::Mat *xyPos, int threads, uchar key = 0);
+    
     /**
      *  Computes the first order derivatives of a given 2D Euclidean signed distance
      *  level-set in x- and y- direction at each pixel using central differences with
@@ -53,12 +71,26 @@ public:
      *  derivatives shall be computed (single channel, float).
      *  @param  dX The output derivatives in x-direction (single channel, float).
      *  @param  dY The output derivatives in y-direction (single channel, float).
-     *  @param  threads The number of threads to be used for parallelization.
+     *  @param  threads The number of work chunks the rows are split into for the thread pool (0 = chosen from the pool size).
      */
     void computeDerivatives(const cv::Mat &sdt, cv::Mat &dX, cv::Mat &dY, int threads);
     
 private:
+    void transform(const cv::Mat &src, cv::Mat &sdt, cv::Mat &xyPos, int threads, uchar key);
+    
     float maxDist;
+    
+    // scratch buffers kept between the calls
+    cv::Mat dd;
+    cv::Mat xPos;
+    std::vector<int> v;
+    std::vector<int> z;
+    std::vector<int> f;
+    
+    // the input copy, transform and closest contour points of the extended ROI
+    cv::Mat bandSrc;
+    cv::Mat bandSdt;
+    cv::Mat bandXYPos;
 };
 
 
@@ -135,7 +167,8 @@ public:
                 for(j = 0; j < _src.cols; j++)
                 {
                     dd[j * _src.rows + y] = INT_MAX + !!src_row[j];
-                    xPos[y * _src.cols + j] = -1;
+                    if(xPos)
+                        xPos[y * _src.cols + j] = -1;
                 }
             }
             else
@@ -159,7 +192,8 @@ public:
                     for(;;)
                     {
                         dd[j * _src.rows + y] = !src_row[j] ? d2 : -d2;
-                        xPos[y * _src.cols + j] = zeroPosX;
+                        if(xPos)
+                            xPos[y * _src.cols + j] = zeroPosX;
                         
                         if(++j >= zk) break;
                         d2+=d1;
@@ -250,7 +284,8 @@ public:
                 for(j = 0; j < _src.cols; j++)
                 {
                     dd[j * _src.rows + y] = INT_MAX + (src_row[j] == _key);
-                    xPos[y * _src.cols + j] = -1;
+                    if(xPos)
+                        xPos[y * _src.cols + j] = -1;
                 }
             }
             else
@@ -274,7 +309,8 @@ public:
                     for(;;)
                     {
                         dd[j * _src.rows + y] = (src_row[j] != _key) ? d2 : -d2;
-                        xPos[y * _src.cols + j] = zeroPosX;
+                        if(xPos)
+                            xPos[y * _src.cols + j] = zeroPosX;
                         
                         if(++j >= zk) break;
                         d2+=d1;
@@ -455,13 +491,14 @@ public:
                 psign=sign;
                 q2+=i<<3;
             }
-            if(k<0) // NOT A SINGLE FOREGROUND PIXEL!!
+            if(k<0) // NOT A SINGLE CONTOUR PIXEL IN THIS COLUMN!!
             {
+                // the column lies entirely on one side, which is inside for a cropped input
                 for(i = 0; i < _src.rows; i++)
                 {
-                    _d[i*_src.cols+x] = INT_MAX;
+                    _d[i*_src.cols+x] = (dd[x*_src.rows+i] < 0) ? -INT_MAX : INT_MAX;
                 }
-                break;
+                continue;
             }
             else
             {
@@ -491,7 +528,7 @@ public:
                         
                         _d[i*_src.cols+x] = ds;
                         
-                        if(fabs(ds) <= _maxDist)
+                        if(xyPos && fabs(ds) <= _maxDist)
                         {
                             int py = (i < zeroPosY) ? zeroPosY-!bg : zeroPosY-bg;
                             
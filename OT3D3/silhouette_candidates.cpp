@@ -0,0 +1,269 @@
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include "silhouette_candidates.h"
+
+static const char kSilhouetteMagic[6] = { 'O', 'T', '3', 'D', 'S', 'C' };
+static const int kSilhouetteVersion = 3;
+
+template <typename T>
+static void WriteRaw(std::ofstream& ofs, const T& value) {
+	ofs.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static bool ReadRaw(std::ifstream& ifs, T& value) {
+	return (bool)ifs.read((char*)&value, sizeof(T));
+}
+
+SilhouetteCandidates::SilhouetteCandidates() : cellsPerFace(0), maxRatio(0.0f), center(0, 0, 0), radius(0.0f), numPoints(0) {
+}
+
+cv::Vec3f SilhouetteCandidates::GetDirection(int face, float u, float v) const {
+	// face 2 * axis + (negative ? 1 : 0), u and v are the remaining coordinates in cyclic order
+	int axis = face / 2;
+	float sign = (face % 2) ? -1.0f : 1.0f;
+
+	cv::Vec3f d;
+	d[axis] = sign;
+	d[(axis + 1) % 3] = u;
+	d[(axis + 2) % 3] = v;
+	return d / (float)cv::norm(d);
+}
+
+int SilhouetteCandidates::GetCell(const cv::Vec3f& direction) const {
+	int axis = 0;
+	for (int a = 1; a < 3; a++) {
+		if (fabs(direction[a]) > fabs(direction[axis]))
+			axis = a;
+	}
+
+	float major = fabs(direction[axis]);
+	int face = 2 * axis + (direction[axis] < 0 ? 1 : 0);
+
+	float u = direction[(axis + 1) % 3] / major;
+	float v = direction[(axis + 2) % 3] / major;
+
+	int i = std::min(std::max((int)((u + 1.0f) * 0.5f * cellsPerFace), 0), cellsPerFace - 1);
+	int j = std::min(std::max((int)((v + 1.0f) * 0.5f * cellsPerFace), 0), cellsPerFace - 1);
+
+	return (face * cellsPerFace + j) * cellsPerFace + i;
+}
+
+void SilhouetteCandidates::Build(const std::vector<cv::Vec3f>& vertices, const std::vector<unsigned int>& indices, int cellsPerFace, float maxRatio, const std::vector<int>* pointFaces) {
+	this->cellsPerFace = cellsPerFace;
+	this->maxRatio = maxRatio;
+	numPoints = pointFaces ? (int)pointFaces->size() : (int)vertices.size();
+
+	offsets.clear();
+	candidates.clear();
+	if (vertices.empty() || cellsPerFace <= 0)
+		return;
+
+	cv::Vec3f lbn = vertices[0], rtf = vertices[0];
+	for (auto& v : vertices) {
+		for (int a = 0; a < 3; a++) {
+			lbn[a] = std::min(lbn[a], v[a]);
+			rtf[a] = std::max(rtf[a], v[a]);
+		}
+	}
+	center = (lbn + rtf) * 0.5f;
+	radius = 0.0f;
+	for (auto& v : vertices) {
+		radius = std::max(radius, (float)cv::norm(v - center));
+	}
+
+	// face normals and the distance of their planes to the center, relative to the radius
+	int numFaces = (int)indices.size() / 3;
+	std::vector<cv::Vec3f> normals(numFaces);
+	std::vector<float> offsets_rel(numFaces);
+	for (int f = 0; f < numFaces; f++) {
+		const cv::Vec3f& v0 = vertices[indices[3 * f]];
+		const cv::Vec3f& v1 = vertices[indices[3 * f + 1]];
+		const cv::Vec3f& v2 = vertices[indices[3 * f + 2]];
+
+		cv::Vec3f n = (v1 - v0).cross(v2 - v0);
+		float len = (float)cv::norm(n);
+		normals[f] = len > 0.0f ? n / len : cv::Vec3f(0, 0, 0);
+		offsets_rel[f] = radius > 0.0f ? fabs(normals[f].dot(v0 - center)) / radius : 0.0f;
+	}
+
+	// edges as (lower vertex, higher vertex, face), adjacent faces end up next to each other
+	struct Edge {
+		unsigned int a, b;
+		int face;
+		bool operator<(const Edge& o) const { return a != o.a ? a < o.a : (b != o.b ? b < o.b : face < o.face); }
+	};
+	std::vector<Edge> edges;
+	edges.reserve(indices.size());
+	for (int f = 0; f < numFaces; f++) {
+		for (int k = 0; k < 3; k++) {
+			unsigned int a = indices[3 * f + k];
+			unsigned int b = indices[3 * f + (k + 1) % 3];
+			edges.push_back({ std::min(a, b), std::max(a, b), f });
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	// manifold edges with their two faces, all other edges are candidates in every cell
+	std::vector<Edge> shared;
+	std::vector<int> pairs;
+	std::vector<uchar> always(vertices.size(), 0);
+	std::vector<uchar> alwaysFaces(numFaces, 0);
+	for (int e = 0; e < edges.size();) {
+		int n = 1;
+		while (e + n < edges.size() && edges[e + n].a == edges[e].a && edges[e + n].b == edges[e].b)
+			n++;
+
+		if (n == 2) {
+			shared.push_back(edges[e]);
+			pairs.push_back(edges[e + 1].face);
+		} else {
+			always[edges[e].a] = 1;
+			always[edges[e].b] = 1;
+			for (int k = 0; k < n; k++) {
+				alwaysFaces[edges[e + k].face] = 1;
+			}
+		}
+		e += n;
+	}
+
+	int numCells = GetNumCells();
+	offsets.assign(numCells + 1, 0);
+
+	std::vector<signed char> sides(numFaces);
+	std::vector<uchar> marked(vertices.size());
+	std::vector<uchar> markedFaces(numFaces);
+
+	for (int cell = 0; cell < numCells; cell++) {
+		int face = cell / (cellsPerFace * cellsPerFace);
+		int j = (cell / cellsPerFace) % cellsPerFace;
+		int i = cell % cellsPerFace;
+
+		float step = 2.0f / cellsPerFace;
+		float u0 = -1.0f + i * step;
+		float v0 = -1.0f + j * step;
+		cv::Vec3f dc = GetDirection(face, u0 + 0.5f * step, v0 + 0.5f * step);
+
+		// largest deviation of a direction within the cell, reached at a corner
+		float chord = 0.0f;
+		for (int c = 0; c < 4; c++) {
+			cv::Vec3f corner = GetDirection(face, u0 + (c % 2) * step, v0 + (c / 2) * step);
+			chord = std::max(chord, (float)cv::norm(corner - dc));
+		}
+		chord += 1e-3f;
+
+		// 1: front facing, -1: back facing, 0: depends on the exact camera
+		for (int f = 0; f < numFaces; f++) {
+			float s = normals[f].dot(dc);
+			float bound = chord + offsets_rel[f] * maxRatio;
+			sides[f] = (s + bound < 0.0f) ? 1 : ((s - bound > 0.0f) ? -1 : 0);
+		}
+
+		std::copy(always.begin(), always.end(), marked.begin());
+		std::copy(alwaysFaces.begin(), alwaysFaces.end(), markedFaces.begin());
+		for (int e = 0; e < shared.size(); e++) {
+			signed char s0 = sides[shared[e].face];
+			signed char s1 = sides[pairs[e]];
+			if (s0 == 0 || s0 != s1) {
+				marked[shared[e].a] = 1;
+				marked[shared[e].b] = 1;
+				markedFaces[shared[e].face] = 1;
+				markedFaces[pairs[e]] = 1;
+			}
+		}
+
+		if (pointFaces) {
+			for (int p = 0; p < pointFaces->size(); p++) {
+				if (markedFaces[(*pointFaces)[p]])
+					candidates.push_back(p);
+			}
+		} else {
+			for (int v = 0; v < marked.size(); v++) {
+				if (marked[v])
+					candidates.push_back(v);
+			}
+		}
+		offsets[cell + 1] = (int)candidates.size();
+	}
+}
+
+bool SilhouetteCandidates::GetCandidates(const cv::Matx44f& T_cm, const int*& ids, int& count) const {
+	if (offsets.empty())
+		return false;
+
+	// camera center in model coordinates
+	cv::Matx33f R = T_cm.get_minor<3, 3>(0, 0);
+	cv::Vec3f t(T_cm(0, 3), T_cm(1, 3), T_cm(2, 3));
+	cv::Vec3f c = -(R.t() * t);
+
+	cv::Vec3f d = center - c;
+	float dist = (float)cv::norm(d);
+	if (dist <= 0.0f || radius > maxRatio * dist)
+		return false;
+
+	int cell = GetCell(d / dist);
+	ids = candidates.data() + offsets[cell];
+	count = offsets[cell + 1] - offsets[cell];
+	return true;
+}
+
+bool SilhouetteCandidates::Save(const std::string& file, unsigned long long meshHash) const {
+	std::ofstream ofs(file, std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+
+	ofs.write(kSilhouetteMagic, sizeof(kSilhouetteMagic));
+	WriteRaw(ofs, kSilhouetteVersion);
+	WriteRaw(ofs, meshHash);
+	WriteRaw(ofs, numPoints);
+	WriteRaw(ofs, cellsPerFace);
+	WriteRaw(ofs, maxRatio);
+	WriteRaw(ofs, center);
+	WriteRaw(ofs, radius);
+	WriteRaw(ofs, (int)candidates.size());
+
+	ofs.write((const char*)offsets.data(), offsets.size() * sizeof(int));
+	ofs.write((const char*)candidates.data(), candidates.size() * sizeof(int));
+
+	return ofs.good();
+}
+
+bool SilhouetteCandidates::Load(const std::string& file, unsigned long long meshHash, int numPoints) {
+	offsets.clear();
+	candidates.clear();
+
+	std::ifstream ifs(file, std::ios::binary);
+	if (!ifs.is_open())
+		return false;
+
+	char magic[sizeof(kSilhouetteMagic)];
+	int version = 0;
+	if (!ifs.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kSilhouetteMagic))
+		return false;
+	if (!ReadRaw(ifs, version) || version != kSilhouetteVersion)
+		return false;
+
+	unsigned long long fileHash = 0;
+	int numCandidates = 0;
+	if (!ReadRaw(ifs, fileHash) || !ReadRaw(ifs, this->numPoints) || !ReadRaw(ifs, cellsPerFace) || !ReadRaw(ifs, maxRatio)
+		|| !ReadRaw(ifs, center) || !ReadRaw(ifs, radius) || !ReadRaw(ifs, numCandidates))
+		return false;
+
+	// built for another mesh, also one with moved vertices
+	if (fileHash != meshHash || this->numPoints != numPoints || cellsPerFace <= 0 || numCandidates < 0)
+		return false;
+
+	offsets.resize(GetNumCells() + 1);
+	candidates.resize(numCandidates);
+	ifs.read((char*)offsets.data(), offsets.size() * sizeof(int));
+	ifs.read((char*)candidates.data(), candidates.size() * sizeof(int));
+	if (!ifs || offsets.back() != numCandidates) {
+		offsets.clear();
+		candidates.clear();
+		return false;
+	}
+
+	return true;
+}
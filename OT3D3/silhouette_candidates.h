@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+/**
+ *  View-dependent lists of the mesh vertices that can lie on the silhouette. The
+ *  viewing directions are binned into the cells of a cube map. For every cell, an
+ *  edge is a candidate unless both adjacent faces are front facing, or both are back
+ *  facing, for every direction in the cell and every camera at least 1 / maxRatio
+ *  bounding radii away. Boundary and non-manifold edges are always candidates. The
+ *  listed points are either the vertices of the candidate edges or, for surface
+ *  samples, the samples on triangles adjacent to a candidate edge. The lists are
+ *  stored in CSR form (offsets into one index array).
+ */
+class SilhouetteCandidates {
+public:
+	SilhouetteCandidates();
+
+	/**
+	 *  Builds the candidate lists from the triangle mesh.
+	 *
+	 *  @param  vertices The mesh vertices.
+	 *  @param  indices The vertex indices of the triangles.
+	 *  @param  cellsPerFace The number of cells along each side of a cube map face.
+	 *  @param  maxRatio The largest ratio of bounding radius to camera distance the lists are valid for.
+	 *  @param  pointFaces The triangle of every surface sample if the lists shall index samples instead of vertices.
+	 */
+	void Build(const std::vector<cv::Vec3f>& vertices, const std::vector<unsigned int>& indices, int cellsPerFace, float maxRatio, const std::vector<int>* pointFaces = NULL);
+
+	/**
+	 *  Saves the lists keyed by the hash of the mesh they have been built for, see HashMesh().
+	 */
+	bool Save(const std::string& file, unsigned long long meshHash) const;
+
+	/**
+	 *  Loads the lists if they have been built for the mesh with the given hash and the given number of points.
+	 */
+	bool Load(const std::string& file, unsigned long long meshHash, int numPoints);
+
+	/**
+	 *  Returns the candidate vertices for a pose.
+	 *
+	 *  @param  T_cm The model to camera transformation.
+	 *  @param  ids Set to the sorted point indices of the candidates.
+	 *  @param  count Set to the number of candidates.
+	 *  @return False if the lists are empty or the camera is too close, all points have to be used then.
+	 */
+	bool GetCandidates(const cv::Matx44f& T_cm, const int*& ids, int& count) const;
+
+	bool IsEmpty() const { return offsets.empty(); }
+	int GetNumCells() const { return 6 * cellsPerFace * cellsPerFace; }
+
+protected:
+	int GetCell(const cv::Vec3f& direction) const;
+	cv::Vec3f GetDirection(int face, float u, float v) const;
+
+	int cellsPerFace;
+	float maxRatio;
+
+	cv::Vec3f center;
+	float radius;
+
+	int numPoints;
+
+	std::vector<int> offsets;
+	std::vector<int> candidates;
+};
@@ -0,0 +1,167 @@
+#include <fstream>
+
+#include "stage_timer.h"
+
+static const char* stage_names[StageTimer::NUM_STAGES] = {
+	"render",
+	"readback",
+	"search_line",
+	"bundle",
+	"match",
+	"jacobian",
+	"solve",
+	"histogram"
+};
+
+StageTimer::StageTimer() {
+	origin = Clock::now();
+	record_events = false;
+	max_frames = 1000;
+	Reset();
+}
+
+const char* StageTimer::StageName(int stage) {
+	if (stage < 0 || stage >= NUM_STAGES)
+		return "unknown";
+	return stage_names[stage];
+}
+
+void StageTimer::Reset() {
+	frames.clear();
+	events.clear();
+	iteration = 0;
+	level = -1;
+}
+
+void StageTimer::SetMaxFrames(size_t count) {
+	max_frames = count;
+	DropFrames(max_frames);
+}
+
+void StageTimer::DropFrames(size_t keep) {
+	if (max_frames == 0)
+		return;
+
+	while (frames.size() > keep) {
+		events.erase(events.begin(), events.begin() + frames.front().events);
+		frames.pop_front();
+	}
+}
+
+void StageTimer::BeginFrame(int fid) {
+	// makes room for the new frame
+	if (max_frames > 0)
+		DropFrames(max_frames - 1);
+
+	Frame frame;
+	frame.fid = fid;
+	frame.times.fill(0.0);
+	frame.events = 0;
+	frames.push_back(frame);
+
+	iteration = 0;
+	level = -1;
+}
+
+void StageTimer::BeginIteration(int level) {
+	iteration++;
+	this->level = level;
+}
+
+void StageTimer::Add(Stage stage, const Clock::time_point& start) {
+	Clock::time_point end = Clock::now();
+
+	// stages outside of a frame, e.g. the histogram initialization, belong to no tracked frame
+	if (frames.empty())
+		return;
+
+	double duration = std::chrono::duration<double, std::micro>(end - start).count();
+	frames.back().times[stage] += duration;
+
+	if (record_events) {
+		Event event;
+		event.stage = stage;
+		event.frame = frames.back().fid;
+		event.iteration = iteration;
+		event.level = level;
+		event.start = std::chrono::duration<double, std::micro>(start - origin).count();
+		event.duration = duration;
+		events.push_back(event);
+		frames.back().events++;
+	}
+}
+
+double StageTimer::FrameTime(Stage stage) const {
+	if (frames.empty())
+		return 0.0;
+	return frames.back().times[stage];
+}
+
+bool StageTimer::ExportCSV(const std::string& file) const {
+	std::ofstream ofs(file);
+	if (!ofs.is_open())
+		return false;
+
+	ofs << "frame";
+	for (int s = 0; s < NUM_STAGES; s++)
+		ofs << ',' << stage_names[s] << "_ms";
+	ofs << ",total_ms\n";
+
+	ofs.setf(std::ios_base::fixed, std::ios_base::floatfield);
+	ofs.precision(3);
+	for (auto& frame : frames) {
+		double total = 0.0;
+		ofs << frame.fid;
+		for (int s = 0; s < NUM_STAGES; s++) {
+			ofs << ',' << frame.times[s] / 1000.0;
+			total += frame.times[s];
+		}
+		ofs << ',' << total / 1000.0 << '\n';
+	}
+
+	return ofs.good();
+}
+
+bool StageTimer::ExportJSONLines(const std::string& file) const {
+	std::ofstream ofs(file);
+	if (!ofs.is_open())
+		return false;
+
+	ofs.setf(std::ios_base::fixed, std::ios_base::floatfield);
+	ofs.precision(3);
+	for (auto& frame : frames) {
+		double total = 0.0;
+		ofs << "{\"frame\":" << frame.fid;
+		for (int s = 0; s < NUM_STAGES; s++) {
+			ofs << ",\"" << stage_names[s] << "_ms\":" << frame.times[s] / 1000.0;
+			total += frame.times[s];
+		}
+		ofs << ",\"total_ms\":" << total / 1000.0 << "}\n";
+	}
+
+	return ofs.good();
+}
+
+bool StageTimer::ExportChromeTrace(const std::string& file) const {
+	std::ofstream ofs(file);
+	if (!ofs.is_open())
+		return false;
+
+	// complete events ("ph":"X") with timestamps and durations in microseconds
+	ofs.setf(std::ios_base::fixed, std::ios_base::floatfield);
+	ofs.precision(3);
+	ofs << "{\"traceEvents\":[\n";
+	for (size_t i = 0; i < events.size(); i++) {
+		const Event& event = events[i];
+		ofs << "{\"name\":\"" << stage_names[event.stage] << "\",\"cat\":\"tracker\",\"ph\":\"X\""
+			<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+			<< ",\"pid\":0,\"tid\":0"
+			<< ",\"args\":{\"frame\":" << event.frame << ",\"iteration\":" << event.iteration << ",\"level\":" << event.level << "}}";
+		if (i + 1 < events.size())
+			ofs << ',';
+		ofs << '\n';
+	}
+	ofs << "],\"displayTimeUnit\":\"ms\"}\n";
+
+	return ofs.good();
+}
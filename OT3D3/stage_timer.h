@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <string>
+
+/**
+ *  Collects wall-clock timings of the tracking stages based on std::chrono::steady_clock.
+ *  Per-frame totals of every stage are always kept, single events (with frame, iteration
+ *  and pyramid level) only when event recording is enabled. Only the most recent frames
+ *  and their events are kept, see SetMaxFrames(). The results can be exported as CSV,
+ *  JSON lines or a Chrome trace-event file (chrome://tracing, Perfetto).
+ */
+class StageTimer {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	enum Stage {
+		RENDER = 0,
+		READBACK,
+		SEARCH_LINE,
+		BUNDLE,
+		MATCH,
+		JACOBIAN,
+		SOLVE,
+		HISTOGRAM,
+		NUM_STAGES
+	};
+
+	/**
+	 *  Adds the time between its construction and destruction to a stage, on every path
+	 *  out of its block.
+	 */
+	class Scope {
+	public:
+		Scope(StageTimer& timer, Stage stage) : timer(timer), stage(stage), start(Clock::now()) {}
+		~Scope() { timer.Add(stage, start); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		StageTimer& timer;
+		Stage stage;
+		Clock::time_point start;
+	};
+
+	StageTimer();
+
+	static const char* StageName(int stage);
+	static Clock::time_point Now() { return Clock::now(); }
+
+	/**
+	 *  Clears all frames and events, e.g. before a new input sequence.
+	 */
+	void Reset();
+
+	void SetRecordEvents(bool enable) { record_events = enable; }
+	bool GetRecordEvents() const { return record_events; }
+
+	/**
+	 *  Limits the number of kept frames, the oldest frames and their events are dropped
+	 *  when a new one begins (default = 1000, 0 = keep all frames, e.g. for a batch export).
+	 */
+	void SetMaxFrames(size_t count);
+	size_t GetMaxFrames() const { return max_frames; }
+
+	/**
+	 *  Starts a new frame; all following stages are accounted to it.
+	 */
+	void BeginFrame(int fid);
+
+	/**
+	 *  Starts a new pose iteration of the current frame at a given pyramid level.
+	 */
+	void BeginIteration(int level);
+
+	/**
+	 *  Adds the time from start until now to a stage of the current frame. Stages before
+	 *  the first frame, e.g. the histogram initialization, are not recorded.
+	 */
+	void Add(Stage stage, const Clock::time_point& start);
+
+	/**
+	 *  Returns the accumulated time of a stage in the current frame in microseconds.
+	 */
+	double FrameTime(Stage stage) const;
+
+	bool ExportCSV(const std::string& file) const;
+	bool ExportJSONLines(const std::string& file) const;
+	bool ExportChromeTrace(const std::string& file) const;
+
+protected:
+	struct Event {
+		int stage;
+		int frame;
+		int iteration;
+		int level;
+		double start;	// us since the creation of the timer
+		double duration;	// us
+	};
+
+	struct Frame {
+		int fid;
+		std::array<double, NUM_STAGES> times;	// us
+		size_t events;	// recorded events of the frame
+	};
+
+	// drops the oldest frames and their events until at most keep frames are left
+	void DropFrames(size_t keep);
+
+	Clock::time_point origin;
+
+	std::deque<Frame> frames;
+	std::deque<Event> events;
+
+	size_t max_frames;
+
+	int iteration;
+	int level;
+
+	bool record_events;
+};
@@ -0,0 +1,204 @@
+#include <cmath>
+#include <queue>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "surface_samples.h"
+
+static const char kSurfaceSamplesMagic[6] = { 'O', 'T', '3', 'D', 'S', 'S' };
+static const int kSurfaceSamplesVersion = 2;
+
+// candidates per sample before the elimination
+static const int kCandidateFactor = 5;
+
+template <typename T>
+static void WriteRaw(std::ofstream& ofs, const T& value) {
+	ofs.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static bool ReadRaw(std::ifstream& ifs, T& value) {
+	return (bool)ifs.read((char*)&value, sizeof(T));
+}
+
+// PCG-style LCG, so the samples do not depend on the standard library implementation
+static float Uniform(unsigned long long& state) {
+	state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (float)((state >> 40) & 0xffffff) * (1.0f / 16777216.0f);
+}
+
+SurfaceSamples::SurfaceSamples() {
+}
+
+bool SurfaceSamples::Build(const std::vector<cv::Vec3f>& vertices, const std::vector<unsigned int>& indices, int count) {
+	points.clear();
+	faces.clear();
+
+	int numFaces = (int)indices.size() / 3;
+	if (numFaces == 0 || count <= 0)
+		return false;
+
+	// cumulative triangle areas for the area-weighted choice
+	std::vector<double> cdf(numFaces);
+	double area = 0.0;
+	for (int f = 0; f < numFaces; f++) {
+		const cv::Vec3f& v0 = vertices[indices[3 * f]];
+		const cv::Vec3f& v1 = vertices[indices[3 * f + 1]];
+		const cv::Vec3f& v2 = vertices[indices[3 * f + 2]];
+		area += 0.5 * cv::norm((v1 - v0).cross(v2 - v0));
+		cdf[f] = area;
+	}
+	if (area <= 0.0)
+		return false;
+
+	int numCandidates = count * kCandidateFactor;
+	std::vector<cv::Vec3f> candidates(numCandidates);
+	std::vector<int> candidateFaces(numCandidates);
+
+	unsigned long long state = 0x853c49e6748fea9bULL;
+	for (int i = 0; i < numCandidates; i++) {
+		double a = Uniform(state) * area;
+		int f = (int)(std::lower_bound(cdf.begin(), cdf.end(), a) - cdf.begin());
+		f = std::min(f, numFaces - 1);
+
+		const cv::Vec3f& v0 = vertices[indices[3 * f]];
+		const cv::Vec3f& v1 = vertices[indices[3 * f + 1]];
+		const cv::Vec3f& v2 = vertices[indices[3 * f + 2]];
+
+		// uniform barycentric coordinates
+		float r1 = sqrt(Uniform(state));
+		float r2 = Uniform(state);
+		candidates[i] = (1.0f - r1) * v0 + r1 * (1.0f - r2) * v1 + r1 * r2 * v2;
+		candidateFaces[i] = f;
+	}
+
+	// maximum Poisson-disk radius of count samples on the surface
+	float rmax = (float)sqrt(area / (2.0 * sqrt(3.0) * count));
+	float cell = 2.0f * rmax;
+
+	std::unordered_map<long long, std::vector<int> > grid;
+	auto key = [](int x, int y, int z) {
+		return ((long long)(x & 0x1fffff) << 42) | ((long long)(y & 0x1fffff) << 21) | (long long)(z & 0x1fffff);
+	};
+	std::vector<cv::Vec3i> cells(numCandidates);
+	for (int i = 0; i < numCandidates; i++) {
+		cells[i] = cv::Vec3i((int)floor(candidates[i][0] / cell), (int)floor(candidates[i][1] / cell), (int)floor(candidates[i][2] / cell));
+		grid[key(cells[i][0], cells[i][1], cells[i][2])].push_back(i);
+	}
+
+	// neighbors within 2 rmax and their weights (1 - d / 2 rmax)^8
+	std::vector<std::vector<std::pair<int, float> > > neighbors(numCandidates);
+	std::vector<float> weights(numCandidates, 0.0f);
+	for (int i = 0; i < numCandidates; i++) {
+		for (int dz = -1; dz <= 1; dz++)
+		for (int dy = -1; dy <= 1; dy++)
+		for (int dx = -1; dx <= 1; dx++) {
+			auto it = grid.find(key(cells[i][0] + dx, cells[i][1] + dy, cells[i][2] + dz));
+			if (it == grid.end())
+				continue;
+
+			for (int j : it->second) {
+				if (j == i)
+					continue;
+
+				float d = (float)cv::norm(candidates[i] - candidates[j]);
+				if (d < cell) {
+					float w = pow(1.0f - d / cell, 8.0f);
+					neighbors[i].push_back(std::make_pair(j, w));
+					weights[i] += w;
+				}
+			}
+		}
+	}
+
+	// repeatedly eliminate the candidate with the densest neighborhood, ties by index
+	std::priority_queue<std::pair<float, int> > heap;
+	for (int i = 0; i < numCandidates; i++) {
+		heap.push(std::make_pair(weights[i], i));
+	}
+
+	std::vector<uchar> removed(numCandidates, 0);
+	int remaining = numCandidates;
+	while (remaining > count && !heap.empty()) {
+		std::pair<float, int> top = heap.top();
+		heap.pop();
+
+		int i = top.second;
+		if (removed[i] || top.first != weights[i])
+			continue;
+
+		removed[i] = 1;
+		remaining--;
+
+		for (auto& n : neighbors[i]) {
+			if (removed[n.first])
+				continue;
+
+			weights[n.first] -= n.second;
+			heap.push(std::make_pair(weights[n.first], n.first));
+		}
+	}
+
+	for (int i = 0; i < numCandidates; i++) {
+		if (!removed[i]) {
+			points.push_back(candidates[i]);
+			faces.push_back(candidateFaces[i]);
+		}
+	}
+
+	return true;
+}
+
+bool SurfaceSamples::Save(const std::string& file, unsigned long long meshHash) const {
+	std::ofstream ofs(file, std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+
+	ofs.write(kSurfaceSamplesMagic, sizeof(kSurfaceSamplesMagic));
+	WriteRaw(ofs, kSurfaceSamplesVersion);
+	WriteRaw(ofs, meshHash);
+	WriteRaw(ofs, (int)points.size());
+
+	ofs.write((const char*)points.data(), points.size() * sizeof(cv::Vec3f));
+	ofs.write((const char*)faces.data(), faces.size() * sizeof(int));
+
+	return ofs.good();
+}
+
+bool SurfaceSamples::Load(const std::string& file, unsigned long long meshHash, int count) {
+	points.clear();
+	faces.clear();
+
+	std::ifstream ifs(file, std::ios::binary);
+	if (!ifs.is_open())
+		return false;
+
+	char magic[sizeof(kSurfaceSamplesMagic)];
+	int version = 0;
+	if (!ifs.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kSurfaceSamplesMagic))
+		return false;
+	if (!ReadRaw(ifs, version) || version != kSurfaceSamplesVersion)
+		return false;
+
+	unsigned long long fileHash = 0;
+	int numPoints = 0;
+	if (!ReadRaw(ifs, fileHash) || !ReadRaw(ifs, numPoints))
+		return false;
+
+	// built for another mesh, also one with moved vertices, or count
+	if (fileHash != meshHash || numPoints != count)
+		return false;
+
+	points.resize(numPoints);
+	faces.resize(numPoints);
+	ifs.read((char*)points.data(), points.size() * sizeof(cv::Vec3f));
+	ifs.read((char*)faces.data(), faces.size() * sizeof(int));
+	if (!ifs) {
+		points.clear();
+		faces.clear();
+		return false;
+	}
+
+	return true;
+}
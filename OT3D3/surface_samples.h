@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+/**
+ *  A uniform sampling of a triangle mesh surface with a fixed number of points,
+ *  used as histogram-center vertices independent of the tessellation. Candidates
+ *  are drawn area-weighted from the triangles with a fixed-seed generator and
+ *  thinned to the target count by weighted sample elimination (Yuksel 2015), which
+ *  yields a Poisson-disk distribution. The result is deterministic for a mesh.
+ */
+class SurfaceSamples {
+public:
+	SurfaceSamples();
+
+	/**
+	 *  Samples the mesh surface.
+	 *
+	 *  @param  vertices The mesh vertices.
+	 *  @param  indices The vertex indices of the triangles.
+	 *  @param  count The number of samples.
+	 *  @return False if the mesh has no surface area.
+	 */
+	bool Build(const std::vector<cv::Vec3f>& vertices, const std::vector<unsigned int>& indices, int count);
+
+	/**
+	 *  Saves the samples keyed by the hash of the mesh they have been built for, see HashMesh().
+	 */
+	bool Save(const std::string& file, unsigned long long meshHash) const;
+
+	/**
+	 *  Loads the samples if they have been built with the given count for the mesh with the given hash.
+	 */
+	bool Load(const std::string& file, unsigned long long meshHash, int count);
+
+	const std::vector<cv::Vec3f>& GetPoints() const { return points; }
+
+	// the triangle every sample lies on
+	const std::vector<int>& GetFaces() const { return faces; }
+
+	bool IsEmpty() const { return points.empty(); }
+
+protected:
+	std::vector<cv::Vec3f> points;
+	std::vector<int> faces;
+};
@@ -0,0 +1,197 @@
+#include <cmath>
+#include <filesystem>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "view.h"
+#include "model.h"
+#include "pose_writer.h"
+#include "transformations.h"
+#include "synthetic_sequence.h"
+
+namespace fs = std::filesystem;
+
+SyntheticSequence::SyntheticSequence(const Settings& settings) {
+	this->settings = settings;
+
+	// all random choices of the trajectory derive from the seed
+	cv::RNG rng(settings.seed);
+
+	axis = cv::Vec3f(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+	if (cv::norm(axis) < 1e-3)
+		axis = cv::Vec3f(0.0f, 1.0f, 0.0f);
+	axis /= (float)cv::norm(axis);
+
+	phase = cv::Vec3f(rng.uniform(0.0f, float(2.0 * CV_PI)), rng.uniform(0.0f, float(2.0 * CV_PI)), rng.uniform(0.0f, float(2.0 * CV_PI)));
+
+	R0 = Transformations::rotationMatrix(rng.uniform(0.0f, 360.0f), cv::Vec3f(1, 0, 0))
+		* Transformations::rotationMatrix(rng.uniform(0.0f, 360.0f), cv::Vec3f(0, 1, 0))
+		* Transformations::rotationMatrix(rng.uniform(0.0f, 360.0f), cv::Vec3f(0, 0, 1));
+
+	color = cv::Vec3f(rng.uniform(0.2f, 1.0f), rng.uniform(0.2f, 1.0f), rng.uniform(0.2f, 1.0f));
+}
+
+cv::Matx44f SyntheticSequence::GetPose(int fid) const {
+	const Settings& s = settings;
+	float t = float(2.0 * CV_PI) * fid / s.period;
+
+	// half of the visible area at the mean distance
+	float hw = s.distance * 0.5f * s.width / s.K(0, 0);
+	float hh = s.distance * 0.5f * s.height / s.K(1, 1);
+
+	// incommensurate frequencies so that the path does not repeat within a few periods
+	float x = s.amplitude * hw * sin(t + phase[0]);
+	float y = s.amplitude * hh * sin(t / 1.37f + phase[1]);
+	float z = s.distance * (1.0f + s.depthAmplitude * sin(t / 0.71f + phase[2]));
+
+	return Transformations::translationMatrix(x, y, z)
+		* Transformations::rotationMatrix(s.angularSpeed * fid, axis)
+		* R0;
+}
+
+cv::Mat SyntheticSequence::GenerateBackground() const {
+	const Settings& s = settings;
+	cv::RNG rng(s.seed * 2654435761u + 1);
+
+	// smooth low-frequency color variation
+	cv::Mat coarse(12, 16, CV_8UC3);
+	rng.fill(coarse, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+	cv::Mat background;
+	cv::resize(coarse, background, cv::Size(s.width, s.height), 0, 0, cv::INTER_CUBIC);
+
+	// high-frequency clutter
+	int numShapes = s.width * s.height / 2000;
+	for (int i = 0; i < numShapes; i++) {
+		cv::Point p(rng.uniform(0, s.width), rng.uniform(0, s.height));
+		cv::Scalar c(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+		int size = rng.uniform(2, std::max(3, s.width / 20));
+		switch (rng.uniform(0, 3)) {
+		case 0:
+			cv::circle(background, p, size, c, cv::FILLED, cv::LINE_AA);
+			break;
+		case 1:
+			cv::rectangle(background, cv::Rect(p.x, p.y, size, rng.uniform(2, size + 1)), c, cv::FILLED);
+			break;
+		default:
+			cv::line(background, p, cv::Point(p.x + rng.uniform(-size, size), p.y + rng.uniform(-size, size)), c, rng.uniform(1, 4), cv::LINE_AA);
+			break;
+		}
+	}
+
+	return background;
+}
+
+cv::Mat SyntheticSequence::RenderFrame(Model* model, const cv::Matx44f& pose, const cv::Mat& background, int fid) const {
+	View* view = View::Instance();
+
+	model->setPose(pose);
+
+	view->setLevel(0);
+	view->RenderShaded(model, GL_FILL, color[0], color[1], color[2], true);
+	cv::Mat shaded = view->DownloadFrame(View::RGB);
+	cv::Mat depth = view->DownloadFrame(View::DEPTH);
+	cv::cvtColor(shaded, shaded, cv::COLOR_RGB2BGR);
+
+	cv::Mat mask;
+	view->ConvertMask(depth, mask, 0);
+
+	cv::Mat frame = background.clone();
+	shaded.copyTo(frame, mask);
+
+	if (settings.noise > 0.0f) {
+		cv::RNG rng(settings.seed * 7919u + fid);
+		cv::Mat noise(frame.size(), CV_16SC3);
+		rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(settings.noise));
+
+		cv::Mat noisy;
+		frame.convertTo(noisy, CV_16SC3);
+		noisy += noise;
+		noisy.convertTo(frame, CV_8UC3);
+	}
+
+	return frame;
+}
+
+bool SyntheticSequence::WriteCalibration(const std::string& file) const {
+	cv::FileStorage fs(file, cv::FileStorage::WRITE);
+	if (!fs.isOpened())
+		return false;
+
+	cv::Mat camera_matrix;
+	cv::Mat(settings.K).convertTo(camera_matrix, CV_64F);
+	cv::Mat distortion_coefficients = cv::Mat::zeros(1, 5, CV_64F);
+
+	fs << "image_width" << settings.width;
+	fs << "image_height" << settings.height;
+	fs << "camera_matrix" << camera_matrix;
+	fs << "distortion_coefficients" << distortion_coefficients;
+
+	return true;
+}
+
+bool SyntheticSequence::WriteInitialPose(const std::string& file) const {
+	cv::FileStorage fs(file, cv::FileStorage::WRITE);
+	if (!fs.isOpened())
+		return false;
+
+	cv::Mat initial_pose;
+	cv::Mat(GetPose(0)).convertTo(initial_pose, CV_64F);
+	fs << "initial_pose" << initial_pose;
+
+	return true;
+}
+
+bool SyntheticSequence::WriteConfig(const std::string& file, const std::string& proj_dir) const {
+	cv::FileStorage fs(file, cv::FileStorage::WRITE);
+	if (!fs.isOpened())
+		return false;
+
+	fs << "zn" << settings.zNear;
+	fs << "zf" << settings.zFar;
+	fs << "scale" << 1.0f;
+	fs << "qualityThreshold" << 0.55f;
+	fs << "projDir" << proj_dir;
+	fs << "color" << "#00ff00";
+
+	return true;
+}
+
+bool SyntheticSequence::Write(Model* model, const std::string& model_file, const std::string& out_dir) const {
+	std::error_code ec;
+	fs::path root = fs::absolute(out_dir, ec);
+	fs::create_directories(root / "Resources", ec);
+	fs::create_directories(root / "frames", ec);
+	if (!fs::is_directory(root / "Resources") || !fs::is_directory(root / "frames"))
+		return false;
+
+	// the model and its optional simplified version next to it, the extension selects the importer
+	std::string model_name = "Model" + fs::path(model_file).extension().string();
+	fs::copy_file(model_file, root / "Resources" / model_name, fs::copy_options::overwrite_existing, ec);
+	if (ec)
+		return false;
+	if (fs::exists(model_file + 's'))
+		fs::copy_file(model_file + 's', root / "Resources" / (model_name + 's'), fs::copy_options::overwrite_existing, ec);
+
+	if (!WriteCalibration((root / "camera_calibration.yaml").string()) ||
+		!WriteInitialPose((root / "Resources" / "initial_pose.yaml").string()) ||
+		!WriteConfig((root / "config.yml").string(), root.generic_string()))
+		return false;
+
+	PoseWriter pose_writer((root / "poses_gt.txt").string(), "synthetic seed " + std::to_string(settings.seed), 1);
+	if (!pose_writer.IsOpen())
+		return false;
+
+	cv::Mat background = GenerateBackground();
+	for (int fid = 0; fid < settings.numFrames; fid++) {
+		cv::Matx44f pose = GetPose(fid);
+		cv::Mat frame = RenderFrame(model, pose, background, fid);
+
+		if (!cv::imwrite((root / "frames" / cv::format("%06d.png", fid)).string(), frame))
+			return false;
+
+		pose_writer.Record(pose, fid);
+	}
+
+	return true;
+}
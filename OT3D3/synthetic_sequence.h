@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+class Model;
+
+/**
+ *  Renders a model along a scripted, seeded pose trajectory over a randomized textured
+ *  background. The output directory follows the layout expected by OT3D3 and OT3D3Batch:
+ *  a config file, camera_calibration.yaml, Resources/initial_pose.yaml, Resources/Model.obj,
+ *  the frames as images and the ground-truth poses in the RBOT format. The same settings
+ *  always produce the same sequence.
+ */
+class SyntheticSequence {
+public:
+	struct Settings {
+		int width = 640;
+		int height = 480;
+		cv::Matx33f K = cv::Matx33f(600.0f, 0.0f, 320.0f, 0.0f, 600.0f, 240.0f, 0.0f, 0.0f, 1.0f);
+		float zNear = 10.0f;
+		float zFar = 10000.0f;
+
+		int numFrames = 300;
+		unsigned int seed = 1;
+
+		float distance = 500.0f;		// mean distance of the object to the camera
+		float amplitude = 0.25f;		// lateral motion as fraction of the visible area at the mean distance
+		float depthAmplitude = 0.2f;	// depth motion as fraction of the mean distance
+		float angularSpeed = 2.0f;		// rotation per frame in degrees
+		float period = 120.0f;			// frames per lateral oscillation
+		float noise = 4.0f;				// std. dev. of the per-frame pixel noise
+	};
+
+	SyntheticSequence(const Settings& settings);
+
+	/**
+	 *  Returns the ground-truth pose of a frame of the trajectory.
+	 *
+	 *  @param  fid The frame index.
+	 *  @return The pose T_cm of the object in the frame.
+	 */
+	cv::Matx44f GetPose(int fid) const;
+
+	/**
+	 *  Generates the background texture of the sequence.
+	 *
+	 *  @return A BGR image of the configured size.
+	 */
+	cv::Mat GenerateBackground() const;
+
+	/**
+	 *  Renders the model in a given pose with the view and composites it over the background.
+	 *  The view must have been initialized with the sequence's calibration and size.
+	 *
+	 *  @param  model The model to be rendered.
+	 *  @param  pose The pose the model is rendered in.
+	 *  @param  background The background the object is composited on.
+	 *  @param  fid The frame index seeding the pixel noise.
+	 *  @return The composited BGR frame.
+	 */
+	cv::Mat RenderFrame(Model* model, const cv::Matx44f& pose, const cv::Mat& background, int fid) const;
+
+	/**
+	 *  Writes the whole sequence.
+	 *
+	 *  @param  model The model to be rendered, its file is copied to Resources/Model.obj.
+	 *  @param  model_file The file the model was loaded from.
+	 *  @param  out_dir The output directory.
+	 *  @return Whether all files could be written.
+	 */
+	bool Write(Model* model, const std::string& model_file, const std::string& out_dir) const;
+
+protected:
+	bool WriteCalibration(const std::string& file) const;
+	bool WriteInitialPose(const std::string& file) const;
+	bool WriteConfig(const std::string& file, const std::string& proj_dir) const;
+
+	Settings settings;
+
+	// trajectory parameters drawn from the seed
+	cv::Vec3f axis;
+	cv::Vec3f phase;
+	cv::Matx44f R0;
+	cv::Vec3f color;
+};
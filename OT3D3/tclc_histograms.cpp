@@ -1,8 +1,11 @@
 #include <iostream>
+#include <cmath>
 #include <opencv2/highgui.hpp>
 
 #include "tclc_histograms.h"
 #include "model.h"
+#include "thread_pool.h"
+#include "point_projector.h"
 
 using namespace std;
 using namespace cv;
@@ -17,8 +20,12 @@ TCLCHistograms::TCLCHistograms(Model *model, int numBins, int radius, float offs
     
     this->_offset = offset;
     
+    this->_minOffset = offset;
+    
     this->_numHistograms = _model->getNumSimpleVertices();
     
+    this->useSilhouetteCandidates = true;
+    
     normalizedFG = Mat::zeros(this->_numHistograms, numBins*numBins*numBins, CV_32FC1);
     normalizedBG = Mat::zeros(this->_numHistograms, numBins*numBins*numBins, CV_32FC1);
     
@@ -407,39 +414,42 @@ public:
 class Parallel_For_computeHistogramCenters : public cv::ParallelLoopBody
 {
 private:
-  std::vector<cv::Vec3f> _verticies;
+  const PointsSoA& _verticies;
+
+  // subset of the vertices to project, all of them if NULL
+  const int* _candidates;
+  int _numPoints;
 
-  std::vector<cv::Point3i>* _centersIds;
+  const PointProjector& _projector;
 
   cv::Mat _depth;
   cv::Mat _mask;
 
   uchar* maskData;
 
-  cv::Matx44f _T_cm;
-  cv::Matx33f _K;
-
   float _zNear;
   float _zFar;
 
   int _m_id;
 
-  int _level;
-
   int downScale;
   int upScale;
 
+  float* _u;
+  float* _v;
+  int* _ids;
+
+  cv::Point3i* _centersIds;
+  int* _counts;
+
   int _threads;
 
 public:
-  Parallel_For_computeHistogramCenters(const cv::Mat& mask, const cv::Mat& depth, const std::vector<cv::Vec3f>& verticies, const cv::Matx44f& T_cm, const cv::Matx33f& K, float zNear, float zFar, int m_id, int level, std::vector<cv::Point3i>* centersIds, int threads)
+  Parallel_For_computeHistogramCenters(const cv::Mat& mask, const cv::Mat& depth, const PointsSoA& verticies, const int* candidates, int numPoints, const PointProjector& projector, float zNear, float zFar, int m_id, int level, float* u, float* v, int* ids, cv::Point3i* centersIds, int* counts, int threads)
+    : _verticies(verticies), _candidates(candidates), _numPoints(numPoints), _projector(projector)
   {
-    _verticies = verticies;
-
     _depth = depth;
 
-    _level = level;
-
     downScale = pow(2, 2 - level);
 
     upScale = pow(2, level);
@@ -453,74 +463,67 @@ public:
       _mask = mask;
     }
 
-    maskData = mask.data;
-
-    _T_cm = T_cm;
-    _K = K;
+    maskData = _mask.data;
 
     _zNear = zNear;
     _zFar = zFar;
 
     _m_id = m_id;
 
+    _u = u;
+    _v = v;
+    _ids = ids;
+
     _centersIds = centersIds;
+    _counts = counts;
 
     _threads = threads;
   }
 
   virtual void operator()(const cv::Range& r) const
   {
-    int range = (int)_verticies.size() / _threads;
-
-    int vEnd = r.end * range;
-    if (r.end == _threads)
-    {
-      vEnd = (int)_verticies.size();
-    }
+    int range = _numPoints / _threads;
 
-    std::vector<cv::Point3i>* tmp = &_centersIds[r.start];
-
-    for (int v = r.start * range; v < vEnd; v++)
+    for (int t = r.start; t < r.end; t++)
     {
-      cv::Vec3f V_m = _verticies[v];
-
-      float X_m = V_m[0];
-      float Y_m = V_m[1];
-      float Z_m = V_m[2];
-
-      float X_c = X_m * _T_cm(0, 0) + Y_m * _T_cm(0, 1) + Z_m * _T_cm(0, 2) + _T_cm(0, 3);
-      float Y_c = X_m * _T_cm(1, 0) + Y_m * _T_cm(1, 1) + Z_m * _T_cm(1, 2) + _T_cm(1, 3);
-      float Z_c = X_m * _T_cm(2, 0) + Y_m * _T_cm(2, 1) + Z_m * _T_cm(2, 2) + _T_cm(2, 3);
+      int vBegin = t * range;
+      int vEnd = (t + 1 == _threads) ? _numPoints : vBegin + range;
+
+      // the visible projections and the accepted centers of a chunk are both written
+      // to the preallocated buffers starting at the chunk's first vertex
+      int n;
+      if (_candidates)
+        n = _projector.ProjectVisible(_verticies, _candidates, vBegin, vEnd, _depth, _zNear, _zFar, 1.0f, _u + vBegin, _v + vBegin, _ids + vBegin);
+      else
+        n = _projector.ProjectVisible(_verticies, vBegin, vEnd, _depth, _zNear, _zFar, 1.0f, _u + vBegin, _v + vBegin, _ids + vBegin);
 
-      float x = X_c / Z_c * _K(0, 0) + _K(0, 2);
-      float y = Y_c / Z_c * _K(1, 1) + _K(1, 2);
+      cv::Point3i* centers = _centersIds + vBegin;
+      int count = 0;
 
-      if (x >= 0 && x < _depth.cols && y >= 0 && y < _depth.rows)
+      for (int k = vBegin; k < vBegin + n; k++)
       {
-        float d = 1.0f - _depth.at<float>(y, x);
+        float x = _u[k];
+        float y = _v[k];
 
-        float Z_d = 2.0f * _zNear * _zFar / (_zFar + _zNear - (2.0f * (d)-1.0) * (_zFar - _zNear));
+        int xi = (int)x;
+        int yi = (int)y;
 
-        if (fabs(Z_c - Z_d) < 1.0f || d == 1.0)
+        if (xi >= downScale && xi < _mask.cols - downScale && yi >= downScale && yi < _mask.rows - downScale)
         {
-          int xi = (int)x;
-          int yi = (int)y;
+          uchar v0 = maskData[yi * _mask.cols + xi] == _m_id;
+          uchar v1 = maskData[yi * _mask.cols + xi + downScale] == _m_id;
+          uchar v2 = maskData[yi * _mask.cols + xi - downScale] == _m_id;
+          uchar v3 = maskData[(yi + downScale) * _mask.cols + xi] == _m_id;
+          uchar v4 = maskData[(yi - downScale) * _mask.cols + xi] == _m_id;
 
-          if (xi >= downScale && xi < _mask.cols - downScale && yi >= downScale && yi < _mask.rows - downScale)
+          if (v0 * v1 * v2 * v3 * v4 == 0)
           {
-            uchar v0 = maskData[yi * _mask.cols + xi] == _m_id;
-            uchar v1 = maskData[yi * _mask.cols + xi + downScale] == _m_id;
-            uchar v2 = maskData[yi * _mask.cols + xi - downScale] == _m_id;
-            uchar v3 = maskData[(yi + downScale) * _mask.cols + xi] == _m_id;
-            uchar v4 = maskData[(yi - downScale) * _mask.cols + xi] == _m_id;
-
-            if (v0 * v1 * v2 * v3 * v4 == 0)
-            {
-              tmp->push_back(cv::Point3i(x * upScale, y * upScale, v));
-            }
+            centers[count++] = cv::Point3i(x * upScale, y * upScale, _ids[k]);
           }
         }
       }
+
+      _counts[t] = count;
     }
   }
 };
@@ -673,9 +676,10 @@ void TCLCHistograms::update(const Mat &frame, const Mat &mask, const Mat &depth,
 {
     _centersIDs = parallelComputeLocalHistogramCenters(mask, depth, K, zNear, zFar, 0);
     
-    filterHistogramCenters(100, 10.0f);
+    filterHistogramCenters(100, _minOffset);
     
-    int threads = (int)_centersIDs.size();
+    ThreadPool* pool = ThreadPool::Instance();
+    int threads = pool->NumChunks((int)_centersIDs.size(), 4);
     
     memset(notNormalizedFG.ptr<int>(), 0, _centersIDs.size()*numBins*numBins*numBins*sizeof(float));
     memset(notNormalizedBG.ptr<int>(), 0, _centersIDs.size()*numBins*numBins*numBins*sizeof(float));
@@ -685,9 +689,9 @@ void TCLCHistograms::update(const Mat &frame, const Mat &mask, const Mat &depth,
     
     //Mat sumsFB = Mat::zeros((int)_centersIDs.size(), 1, CV_32SC2);
     
-    parallel_for_(cv::Range(0, threads), Parallel_For_buildLocalHistograms(frame, mask, _centersIDs, radius, numBins, notNormalizedFG, notNormalizedBG, sumsFB, _model->getModelID(), threads));
+    pool->ParallelFor(cv::Range(0, threads), Parallel_For_buildLocalHistograms(frame, mask, _centersIDs, radius, numBins, notNormalizedFG, notNormalizedBG, sumsFB, _model->getModelID(), threads));
     
-    parallel_for_(cv::Range(0, threads), Parallel_For_mergeLocalHistograms(notNormalizedFG, notNormalizedBG, normalizedFG, normalizedBG, initialized, _centersIDs, sumsFB, afg, abg, threads));
+    pool->ParallelFor(cv::Range(0, threads), Parallel_For_mergeLocalHistograms(notNormalizedFG, notNormalizedBG, normalizedFG, normalizedBG, initialized, _centersIDs, sumsFB, afg, abg, threads));
 
     //wes.resize(_centersIDs.size());
     //for (int i = 0; i < _centersIDs.size(); ++i) {
@@ -699,7 +703,7 @@ void TCLCHistograms::updateCentersAndIds(const cv::Mat &mask, const cv::Mat &dep
 {
     _centersIDs = parallelComputeLocalHistogramCenters(mask, depth, K, zNear, zFar, level);
     
-    filterHistogramCenters(100, 10.0f);
+    filterHistogramCenters(100, _minOffset);
 }
 
 
@@ -737,34 +741,132 @@ vector<Point3i> TCLCHistograms::parallelComputeLocalHistogramCenters(const Mat &
 {
     vector<Point3i> res;
     
-    vector<Vec3f> verticies = _model->getSimpleVertices();
+    const PointsSoA& verticies = _model->getSimpleVerticesSoA();
     Matx44f T_cm = _model->getPose();
     Matx44f T_n = _model->getNormalization();
     
-    vector<vector<Point3i> > centersIdsCollection;
-    centersIdsCollection.resize(8);
+    PointProjector projector(K, T_cm * T_n);
+    
+    // only the vertices that can be on the silhouette from this viewpoint
+    const int* candidates = NULL;
+    int numPoints = verticies.size();
+    if(useSilhouetteCandidates)
+    {
+        if(!_model->getSilhouetteCandidates().GetCandidates(T_cm * T_n, candidates, numPoints))
+        {
+            candidates = NULL;
+            numPoints = verticies.size();
+        }
+    }
+    
+    ThreadPool* pool = ThreadPool::Instance();
+    int threads = pool->NumChunks(numPoints, 64);
     
-    Matx44f T_cm_n = T_cm * T_n;
+    // sized once for the model, reused by every update
+    _projectedU.resize(verticies.size());
+    _projectedV.resize(verticies.size());
+    _projectedIds.resize(verticies.size());
+    _projectedCenters.resize(verticies.size());
+    _chunkCounts.resize(threads);
     
     int m_id = _model->getModelID();
     
-    parallel_for_(cv::Range(0, 8), Parallel_For_computeHistogramCenters(mask, depth, verticies, T_cm_n, K, zNear, zFar, m_id, level, centersIdsCollection.data(), 8));
+    pool->ParallelFor(cv::Range(0, threads), Parallel_For_computeHistogramCenters(mask, depth, verticies, candidates, numPoints, projector, zNear, zFar, m_id, level, _projectedU.data(), _projectedV.data(), _projectedIds.data(), _projectedCenters.data(), _chunkCounts.data(), threads));
     
-    for(int i = 0; i < centersIdsCollection.size(); i++)
+    int range = numPoints / threads;
+    for(int t = 0; t < threads; t++)
     {
-        vector<Point3i> tmp = centersIdsCollection[i];
-        for(int j = 0; j < tmp.size(); j++)
-        {
-            res.push_back(tmp[j]);
-        }
+        res.insert(res.end(), _projectedCenters.begin() + t*range, _projectedCenters.begin() + t*range + _chunkCounts[t]);
     }
     
     return res;
-    
 }
 
 
 void TCLCHistograms::filterHistogramCenters(int numHistograms, float offset)
+{
+    filterCentersPoissonDisk(_centersIDs, numHistograms, offset);
+    
+    _offset = offset;
+}
+
+
+void TCLCHistograms::filterCentersPoissonDisk(vector<Point3i> &centers, int numHistograms, float &offset)
+{
+    if(centers.empty())
+        return;
+    
+    int xMin = centers[0].x, xMax = centers[0].x;
+    int yMin = centers[0].y, yMax = centers[0].y;
+    for(int c = 1; c < centers.size(); c++)
+    {
+        xMin = min(xMin, centers[c].x);
+        xMax = max(xMax, centers[c].x);
+        yMin = min(yMin, centers[c].y);
+        yMax = max(yMax, centers[c].y);
+    }
+    
+    vector<Point3i> res;
+    vector<int> grid;
+    
+    while(true)
+    {
+        float offset2 = offset*offset;
+        
+        // the integer centers of a cell differ by at most cellSize - 1 per axis, which keeps
+        // the cell diagonal below the offset, so a cell admits at most one accepted center
+        int cellSize = max((int)ceil(offset / sqrtf(2.0f)), 1);
+        int reach = max((int)ceil(offset / cellSize), 1);
+        int cols = (xMax - xMin) / cellSize + 1;
+        int rows = (yMax - yMin) / cellSize + 1;
+        
+        grid.assign(cols*rows, -1);
+        res.clear();
+        
+        for(int c = 0; c < centers.size(); c++)
+        {
+            const Point3i &center = centers[c];
+            int gx = (center.x - xMin) / cellSize;
+            int gy = (center.y - yMin) / cellSize;
+            
+            bool accept = true;
+            for(int y = max(gy - reach, 0); y <= min(gy + reach, rows - 1) && accept; y++)
+            {
+                for(int x = max(gx - reach, 0); x <= min(gx + reach, cols - 1); x++)
+                {
+                    int r = grid[y*cols + x];
+                    if(r < 0)
+                        continue;
+                    
+                    int dx = center.x - res[r].x;
+                    int dy = center.y - res[r].y;
+                    if((float)(dx*dx + dy*dy) < offset2)
+                    {
+                        accept = false;
+                        break;
+                    }
+                }
+            }
+            
+            if(accept)
+            {
+                grid[gy*cols + gx] = (int)res.size();
+                res.push_back(center);
+            }
+        }
+        
+        if(res.size() <= numHistograms)
+            break;
+        
+        // the centers lie along the contour, so their number is inversely proportional to the offset
+        offset = max(offset + 1.0f, offset*res.size()/numHistograms);
+    }
+    
+    centers = res;
+}
+
+
+void TCLCHistograms::filterCentersGreedy(vector<Point3i> &centers, int numHistograms, float &offset)
 {
     int offset2 = (offset)*(offset);
     
@@ -774,14 +876,14 @@ void TCLCHistograms::filterHistogramCenters(int numHistograms, float offset)
     {
         res.clear();
         
-        while(_centersIDs.size() > 0)
+        while(centers.size() > 0)
         {
-            Point3i center = _centersIDs[0];
+            Point3i center = centers[0];
             vector<Point3i> tmp;
             res.push_back(center);
-            for(int c2 = 1; c2 < _centersIDs.size(); c2++)
+            for(int c2 = 1; c2 < centers.size(); c2++)
             {
-                Point3i center2 = _centersIDs[c2];
+                Point3i center2 = centers[c2];
                 int dx = center.x - center2.x;
                 int dy = center.y - center2.y;
                 int d = dx*dx + dy*dy;
@@ -791,16 +893,14 @@ void TCLCHistograms::filterHistogramCenters(int numHistograms, float offset)
                     tmp.push_back(center2);
                 }
             }
-            _centersIDs = tmp;
+            centers = tmp;
         }
-        _centersIDs = res;
+        centers = res;
         
         offset += 1.0f;
         offset2 = offset*offset;
     }
     while(res.size() > numHistograms);
-    
-    _offset = offset;
 }
 
 
@@ -844,12 +944,24 @@ int TCLCHistograms::getRadius()
 }
 
 
+void TCLCHistograms::setUseSilhouetteCandidates(bool val)
+{
+    useSilhouetteCandidates = val;
+}
+
+
 float TCLCHistograms::getOffset()
 {
     return _offset;
 }
 
 
+float TCLCHistograms::getMinOffset()
+{
+    return _minOffset;
+}
+
+
 void TCLCHistograms::clear()
 {
     normalizedFG = Mat::zeros(this->_numHistograms, numBins*numBins*numBins, CV_32FC1);
@@ -1099,15 +1211,16 @@ WTCLCHistograms::WTCLCHistograms(Model* model, int numBins, int radius, float of
 
 WTCLCHistograms::~WTCLCHistograms()
 {
-
+  delete SDT2D;
 }
 
 void WTCLCHistograms::update(const Mat& frame, const Mat& mask, const Mat& depth, Matx33f& K, float zNear, float zFar, float afg, float abg) {
   _centersIDs = parallelComputeLocalHistogramCenters(mask, depth, K, zNear, zFar, 0);
 
-  filterHistogramCenters(100, 10.0f);
+  filterHistogramCenters(100, _minOffset);
 
-  int threads = (int)_centersIDs.size();
+  ThreadPool* pool = ThreadPool::Instance();
+  int threads = pool->NumChunks((int)_centersIDs.size(), 4);
 
   memset(notNormalizedFG.ptr<int>(), 0, _centersIDs.size() * numBins * numBins * numBins * sizeof(float));
   memset(notNormalizedBG.ptr<int>(), 0, _centersIDs.size() * numBins * numBins * numBins * sizeof(float));
@@ -1117,11 +1230,23 @@ void WTCLCHistograms::update(const Mat& frame, const Mat& mask, const Mat& depth
 
   //Mat sumsFB = Mat::zeros((int)_centersIDs.size(), 1, CV_32SC2);
   
-  cv::Mat sdt, xyPos;
-  SDT2D->computeTransform(mask, sdt, xyPos, 8, _model->getModelID());
+  // the histograms only cover the pixels within their radius around the centers
+  cv::Rect roi;
+  if (!_centersIDs.empty()) {
+    int xMin = _centersIDs[0].x, xMax = _centersIDs[0].x;
+    int yMin = _centersIDs[0].y, yMax = _centersIDs[0].y;
+    for (const cv::Point3i& center : _centersIDs) {
+      xMin = std::min(xMin, center.x);
+      xMax = std::max(xMax, center.x);
+      yMin = std::min(yMin, center.y);
+      yMax = std::max(yMax, center.y);
+    }
+    roi = cv::Rect(xMin - radius, yMin - radius, xMax - xMin + 2 * radius + 1, yMax - yMin + 2 * radius + 1);
+  }
+  SDT2D->computeNarrowBand(mask, roi, sdt, NULL, 0, _model->getModelID());
   //cv::imshow("sdt", sdt);
   //cv::waitKey();
-  parallel_for_(cv::Range(0, threads), Parallel_For_buildWeightedLocalHistograms(frame, mask, sdt, _centersIDs, radius, numBins, notNormalizedFG, notNormalizedBG, sumsFB, _model->getModelID(), threads));
+  pool->ParallelFor(cv::Range(0, threads), Parallel_For_buildWeightedLocalHistograms(frame, mask, sdt, _centersIDs, radius, numBins, notNormalizedFG, notNormalizedBG, sumsFB, _model->getModelID(), threads));
 
-  parallel_for_(cv::Range(0, threads), Parallel_For_mergeLocalHistograms(notNormalizedFG, notNormalizedBG, normalizedFG, normalizedBG, initialized, _centersIDs, sumsFB, afg, abg, threads));
+  pool->ParallelFor(cv::Range(0, threads), Parallel_For_mergeLocalHistograms(notNormalizedFG, notNormalizedBG, normalizedFG, normalizedBG, initialized, _centersIDs, sumsFB, afg, abg, threads));
 }
\ No newline at end of file
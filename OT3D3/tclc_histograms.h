@@ -107,19 +107,59 @@ public:
     int getRadius();
     
     /**
-     *  Returns the minumum distance between two projected histogram centers during an update
-     *  as specified in the constructor.
+     *  Returns the minumum distance between two projected histogram centers finally used
+     *  in the last update, which starts from the one specified in the constructor.
      *
      *  @return The minumum distance between two projected histogram centers in pixels.
      */
     float getOffset();
     
+    /**
+     *  Returns the minumum distance between two projected histogram centers as specified
+     *  in the constructor, every center filtering starts from it.
+     *
+     *  @return The minumum distance between two projected histogram centers in pixels.
+     */
+    float getMinOffset();
+    
+    /**
+     *  Sets whether only the silhouette candidates of the model for the current
+     *  viewpoint are projected when computing the histogram centers (default), or
+     *  all verticies.
+     *
+     *  @param val True to use the silhouette candidates.
+     */
+    void setUseSilhouetteCandidates(bool val);
+    
     /**
      *  Clears all histograms by resetting them to zero and setting their status to
      *  uninitialized
      */
     void clear();
     
+    /**
+     *  Thins out a list of histogram centers such that no two remaining centers are closer
+     *  than the offset, keeping the earlier one. A uniform grid with a cell diagonal of the
+     *  offset holds at most one accepted center per cell, so every candidate is only tested
+     *  against the 5x5 neighboring cells. While more than numHistograms centers remain, the
+     *  offset is enlarged by the ratio of the counts and the selection is repeated.
+     *
+     *  @param centers The candidate centers in their order of preference, replaced by the selected ones.
+     *  @param numHistograms The maximum number of centers to be kept.
+     *  @param offset The initial minimum distance between two centers in pixels, replaced by the one finally used.
+     */
+    static void filterCentersPoissonDisk(std::vector<cv::Point3i> &centers, int numHistograms, float &offset);
+    
+    /**
+     *  The quadratic greedy selection producing the same result as filterCentersPoissonDisk()
+     *  for a given offset, but growing the offset by one pixel at a time. Kept for comparison.
+     *
+     *  @param centers The candidate centers in their order of preference, replaced by the selected ones.
+     *  @param numHistograms The maximum number of centers to be kept.
+     *  @param offset The initial minimum distance between two centers in pixels, replaced by the one finally used.
+     */
+    static void filterCentersGreedy(std::vector<cv::Point3i> &centers, int numHistograms, float &offset);
+    
     cv::Mat sumsFB;
 
     void TestLine(uchar* frameRow, uchar* maskRow, int xl, int xr, float* localHistogramFG, float* localHistogramBG, float& sum_err, float& sum_all);
@@ -134,6 +174,7 @@ protected:
     int radius;
     
     float _offset;
+    float _minOffset;
     
     cv::Mat notNormalizedFG;
     cv::Mat notNormalizedBG;
@@ -148,6 +189,15 @@ protected:
     Model* _model;
     
     std::vector<cv::Point3i> _centersIDs;
+    
+    bool useSilhouetteCandidates;
+    
+    // preallocated output of the histogram center projection
+    std::vector<float> _projectedU;
+    std::vector<float> _projectedV;
+    std::vector<int> _projectedIds;
+    std::vector<cv::Point3i> _projectedCenters;
+    std::vector<int> _chunkCounts;
 
 
     std::vector<cv::Point3i> computeLocalHistogramCenters(const cv::Mat &mask);
@@ -166,4 +216,7 @@ public:
 
 protected:
   SignedDistanceTransform2D* SDT2D;
+
+  // narrow band transform of the last mask, only valid around the histogram centers
+  cv::Mat sdt;
 };
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include <fstream>
+#include <cstring>
+
+#include "template_cache.h"
+#include "template_view.h"
+#include "object3d.h"
+#include "view.h"
+#include "tclc_histograms.h"
+#include "global_params.h"
+
+using namespace std;
+using namespace cv;
+
+static const char kTemplateCacheMagic[6] = { 'O', 'T', '3', 'D', 'T', 'C' };
+static const int kTemplateCacheVersion = 3;
+
+// the images are aligned within the file, so they can be used in place
+static const int kTemplateCacheAlignment = 16;
+
+// the fixed-size part of a template, without padding
+struct TemplateRecord
+{
+    Matx44f T_cm;
+    float alpha, beta, gamma;
+    float distance;
+    int numLevels;
+};
+
+static void HashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+template <typename T>
+static void HashValue(unsigned long long& hash, const T& value)
+{
+    HashBytes(hash, &value, sizeof(T));
+}
+
+template <typename T>
+static void HashArray(unsigned long long& hash, const std::vector<T>& values)
+{
+    HashValue(hash, (long long)values.size());
+    HashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+template <typename T>
+static void WriteRaw(std::ofstream& ofs, const T& value)
+{
+    ofs.write((const char*)&value, sizeof(T));
+}
+
+static void WritePadding(std::ofstream& ofs)
+{
+    static const char zeros[kTemplateCacheAlignment] = { 0 };
+    long long pos = (long long)ofs.tellp();
+    ofs.write(zeros, (kTemplateCacheAlignment - pos % kTemplateCacheAlignment) % kTemplateCacheAlignment);
+}
+
+template <typename T>
+static void WriteArray(std::ofstream& ofs, const std::vector<T>& values)
+{
+    WriteRaw(ofs, (long long)values.size());
+    ofs.write((const char*)values.data(), values.size() * sizeof(T));
+}
+
+static void WriteMat(std::ofstream& ofs, const Mat& mat)
+{
+    Mat m = mat.isContinuous() ? mat : mat.clone();
+    WriteRaw(ofs, m.rows);
+    WriteRaw(ofs, m.cols);
+    WriteRaw(ofs, m.type());
+    WritePadding(ofs);
+    ofs.write((const char*)m.data, m.total() * m.elemSize());
+}
+
+template <typename T>
+static bool ReadRaw(const char*& p, const char* end, T& value)
+{
+    if (end - p < (ptrdiff_t)sizeof(T))
+        return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+template <typename T>
+static bool ReadArray(const char*& p, const char* end, std::vector<T>& values)
+{
+    long long count = 0;
+    if (!ReadRaw(p, end, count) || count < 0 || (end - p) / (ptrdiff_t)sizeof(T) < count)
+        return false;
+    values.resize((size_t)count);
+    if (count > 0)
+        memcpy(values.data(), p, (size_t)count * sizeof(T));
+    p += count * sizeof(T);
+    return true;
+}
+
+static bool SkipPadding(const char*& p, const char* begin, const char* end)
+{
+    ptrdiff_t padding = (kTemplateCacheAlignment - (p - begin) % kTemplateCacheAlignment) % kTemplateCacheAlignment;
+    if (end - p < padding)
+        return false;
+    p += padding;
+    return true;
+}
+
+// wraps the image in place, it references the mapping
+static bool ReadMat(const char*& p, const char* begin, const char* end, Mat& mat)
+{
+    int rows = 0, cols = 0, type = 0;
+    if (!ReadRaw(p, end, rows) || !ReadRaw(p, end, cols) || !ReadRaw(p, end, type) || rows < 0 || cols < 0)
+        return false;
+    if (!SkipPadding(p, begin, end))
+        return false;
+
+    long long size = (long long)rows * cols * CV_ELEM_SIZE(type);
+    if (end - p < size)
+        return false;
+
+    mat = (rows > 0 && cols > 0) ? Mat(rows, cols, type, (void*)p) : Mat();
+    p += size;
+    return true;
+}
+
+TemplateCache::TemplateCache()
+{
+}
+
+unsigned long long TemplateCache::ComputeKey(Object3D *object, const std::vector<float> &distances, int numLevels)
+{
+    View* view = View::Instance();
+
+    unsigned long long hash = 14695981039346656037ULL;
+    HashValue(hash, kTemplateCacheVersion);
+
+    HashArray(hash, object->getVertices());
+    HashArray(hash, object->getIndices());
+    HashArray(hash, object->getSimpleVertices());
+    TCLCHistograms* tclcHistograms = object->getTCLCHistograms();
+    HashValue(hash, tclcHistograms->getRadius());
+    HashValue(hash, tclcHistograms->getMinOffset());
+    HashValue(hash, tclcHistograms->getNumBins());
+
+    HashValue(hash, view->GetCalibrationMatrix(0));
+    HashValue(hash, view->GetWidth());
+    HashValue(hash, view->GetHeight());
+    HashValue(hash, view->getZNear());
+    HashValue(hash, view->getZFar());
+
+    HashArray(hash, distances);
+    HashValue(hash, numLevels);
+    HashValue(hash, OT3D::GlobalParam::Instance()->templateImages);
+
+    return hash;
+}
+
+bool TemplateCache::Save(const std::string &file, unsigned long long key, const std::vector<TemplateView*> &templates)
+{
+    std::ofstream ofs(file, std::ios::binary);
+    if (!ofs.is_open())
+        return false;
+
+    ofs.write(kTemplateCacheMagic, sizeof(kTemplateCacheMagic));
+    WriteRaw(ofs, kTemplateCacheVersion);
+    WriteRaw(ofs, key);
+    WriteRaw(ofs, (int)templates.size());
+
+    for (auto kv : templates)
+    {
+        TemplateRecord record;
+        record.T_cm = kv->T_cm;
+        record.alpha = kv->_alpha;
+        record.beta = kv->_beta;
+        record.gamma = kv->_gamma;
+        record.distance = kv->_distance;
+        record.numLevels = kv->_numLevels;
+        WriteRaw(ofs, record);
+
+        for (int level = 0; level < kv->_numLevels; level++)
+        {
+            const Rect& roi = kv->roiPyramid[level];
+            WriteRaw(ofs, kv->etaFPyramid[level]);
+            WriteRaw(ofs, roi.x);
+            WriteRaw(ofs, roi.y);
+            WriteRaw(ofs, roi.width);
+            WriteRaw(ofs, roi.height);
+
+            WriteArray(ofs, kv->centersIDsPyramid[level]);
+
+            WriteMat(ofs, kv->maskPyramid[level]);
+            WriteMat(ofs, kv->sdtPyramid[level]);
+            WriteMat(ofs, kv->heavisidePyramid[level]);
+
+            const CompressedPixelData& pixelData = kv->pixelDataPyramid[level];
+            WriteArray(ofs, pixelData.x);
+            WriteArray(ofs, pixelData.y);
+            WriteArray(ofs, pixelData.hsVal);
+            WriteArray(ofs, pixelData.offsets);
+            WriteArray(ofs, pixelData.ids16);
+            WriteArray(ofs, pixelData.ids32);
+        }
+    }
+
+    return ofs.good();
+}
+
+bool TemplateCache::Load(const std::string &file, unsigned long long key, int numTemplates, std::vector<TemplateView*> &templates)
+{
+    templates.clear();
+
+    Close();
+    if (!mapping.Open(file))
+        return false;
+
+    const char* begin = mapping.GetData();
+    const char* end = begin + mapping.GetSize();
+    const char* p = begin;
+
+    char magic[sizeof(kTemplateCacheMagic)];
+    int version = 0;
+    unsigned long long fileKey = 0;
+    int count = 0;
+    if (!ReadRaw(p, end, magic) || memcmp(magic, kTemplateCacheMagic, sizeof(magic)) != 0
+        || !ReadRaw(p, end, version) || version != kTemplateCacheVersion
+        || !ReadRaw(p, end, fileKey) || fileKey != key
+        || !ReadRaw(p, end, count) || count != numTemplates)
+    {
+        Close();
+        return false;
+    }
+
+    bool valid = true;
+    for (int t = 0; t < count && valid; t++)
+    {
+        TemplateRecord record;
+        if (!ReadRaw(p, end, record) || record.numLevels < 0)
+        {
+            valid = false;
+            break;
+        }
+
+        TemplateView* kv = new TemplateView();
+        kv->T_cm = record.T_cm;
+        kv->_alpha = record.alpha;
+        kv->_beta = record.beta;
+        kv->_gamma = record.gamma;
+        kv->_distance = record.distance;
+        kv->_numLevels = record.numLevels;
+
+        kv->centersIDsPyramid.resize(kv->_numLevels);
+        kv->roiPyramid.resize(kv->_numLevels);
+        kv->etaFPyramid.resize(kv->_numLevels);
+        kv->maskPyramid.resize(kv->_numLevels);
+        kv->sdtPyramid.resize(kv->_numLevels);
+        kv->heavisidePyramid.resize(kv->_numLevels);
+        kv->pixelDataPyramid.resize(kv->_numLevels);
+
+        templates.push_back(kv);
+
+        for (int level = 0; level < kv->_numLevels; level++)
+        {
+            Rect& roi = kv->roiPyramid[level];
+            if (!ReadRaw(p, end, kv->etaFPyramid[level]) || !ReadRaw(p, end, roi.x) || !ReadRaw(p, end, roi.y)
+                || !ReadRaw(p, end, roi.width) || !ReadRaw(p, end, roi.height) || !ReadArray(p, end, kv->centersIDsPyramid[level]))
+            {
+                valid = false;
+                break;
+            }
+
+            if (!ReadMat(p, begin, end, kv->maskPyramid[level]) || !ReadMat(p, begin, end, kv->sdtPyramid[level])
+                || !ReadMat(p, begin, end, kv->heavisidePyramid[level]))
+            {
+                valid = false;
+                break;
+            }
+
+            CompressedPixelData& pixelData = kv->pixelDataPyramid[level];
+            if (!ReadArray(p, end, pixelData.x) || !ReadArray(p, end, pixelData.y) || !ReadArray(p, end, pixelData.hsVal)
+                || !ReadArray(p, end, pixelData.offsets) || !ReadArray(p, end, pixelData.ids16) || !ReadArray(p, end, pixelData.ids32))
+            {
+                valid = false;
+                break;
+            }
+
+            // the offsets have to stay within the IDs
+            size_t numPixels = pixelData.x.size();
+            long long numIDs = (long long)(pixelData.ids32.empty() ? pixelData.ids16.size() : pixelData.ids32.size());
+            if (pixelData.y.size() != numPixels || pixelData.hsVal.size() != numPixels
+                || (pixelData.offsets.size() != numPixels + 1 && !(pixelData.offsets.empty() && numPixels == 0))
+                || (!pixelData.offsets.empty() && pixelData.offsets[0] != 0)
+                || (!pixelData.ids16.empty() && !pixelData.ids32.empty()))
+            {
+                valid = false;
+                break;
+            }
+            for (size_t i = 1; i < pixelData.offsets.size() && valid; i++)
+            {
+                if (pixelData.offsets[i] < pixelData.offsets[i - 1] || pixelData.offsets[i] > numIDs)
+                    valid = false;
+            }
+            if (!valid)
+                break;
+        }
+    }
+
+    if (!valid)
+    {
+        for (auto kv : templates)
+        {
+            delete kv;
+        }
+        templates.clear();
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void TemplateCache::Close()
+{
+    mapping.Close();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+class Object3D;
+class TemplateView;
+
+/**
+ *  A persistent cache of rendered template views. The templates of an object
+ *  are written to one versioned binary file, later runs map the file and
+ *  create the template views directly on top of the mapping, so the masks,
+ *  signed distance transforms and Heaviside images are not copied. The
+ *  compressed pixel data is copied with one block per array. The file is
+ *  keyed by a hash of everything the templates depend on and is only used
+ *  while it matches.
+ */
+class TemplateCache
+{
+public:
+    TemplateCache();
+
+    /**
+     *  Computes the 64 bit FNV-1a hash of the model geometry, the histogram
+     *  vertices, radius, center offset and number of bins, the camera
+     *  intrinsics and image size, the near and far plane, the template
+     *  distances, the number of pyramid levels and the kept template images.
+     *
+     *  @param  object The object the templates are rendered for.
+     *  @param  distances The template distances.
+     *  @param  numLevels The number of template pyramid levels.
+     *  @return The cache key.
+     */
+    static unsigned long long ComputeKey(Object3D *object, const std::vector<float> &distances, int numLevels);
+
+    /**
+     *  Writes the templates to a cache file.
+     *
+     *  @param  file The cache file.
+     *  @param  key The cache key of the templates.
+     *  @param  templates The templates in generation order.
+     *  @return False if the file could not be written.
+     */
+    static bool Save(const std::string &file, unsigned long long key, const std::vector<TemplateView*> &templates);
+
+    /**
+     *  Maps a cache file and creates its templates on top of the mapping. The
+     *  mapping stays open until Close() or the destruction of the cache, the
+     *  loaded templates must be deleted before. Their images must not be
+     *  written to.
+     *
+     *  @param  file The cache file.
+     *  @param  key The expected cache key.
+     *  @param  numTemplates The expected number of templates.
+     *  @param  templates Set to the loaded templates in generation order.
+     *  @return False if the file does not exist, is stale or damaged.
+     */
+    bool Load(const std::string &file, unsigned long long key, int numTemplates, std::vector<TemplateView*> &templates);
+
+    void Close();
+
+private:
+    MappedFile mapping;
+};
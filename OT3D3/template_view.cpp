@@ -1,8 +1,19 @@
+#include <climits>
+#include <algorithm>
+
 #include "template_view.h"
+#include "thread_pool.h"
+#include "global_params.h"
 
 using namespace std;
 using namespace cv;
 
+// fixed point scale of the 16 bit SDTs
+static const float kSDTScale = 64.0f;
+
+// the 8 bit Heaviside images hold the values in 1/254 steps and this outside of the band
+static const uchar kHeavisideOutside = 255;
+
 TemplateView::TemplateView(Object3D *object, float alpha, float beta, float gamma, float distance, int numLevels, bool generateNeighbors)
 {
     T_cm = Transformations::translationMatrix(0, 0, distance)*Transformations::rotationMatrix(gamma, Vec3f(0, 0, 1))*Transformations::rotationMatrix(alpha, Vec3f(1, 0, 0))*Transformations::rotationMatrix(beta, Vec3f(0, 1, 0));
@@ -42,7 +53,10 @@ TemplateView::TemplateView(Object3D *object, float alpha, float beta, float gamm
     heavisidePyramid.resize(_numLevels);
     pixelDataPyramid.resize(_numLevels);
     
-    SignedDistanceTransform2D SDT2D(8.0f);
+    // the scratch buffers are reused by all templates rendered on a thread
+    static thread_local SignedDistanceTransform2D SDT2D(8.0f);
+    
+    int images = OT3D::GlobalParam::Instance()->templateImages;
     
     Size maxSize = mask0.size();
     
@@ -70,34 +84,52 @@ TemplateView::TemplateView(Object3D *object, float alpha, float beta, float gamm
         
         etaFPyramid[level] = countNonZero(mask);
         
-        maskPyramid[level] = mask*255;
-        
-        Mat sdt, xyPos;
-        SDT2D.computeTransform(mask, sdt, xyPos, 8);
-    
-        sdtPyramid[level] = sdt;
+        // the Heaviside function is only evaluated within the band of 8 pixels
+        Mat sdt;
+        SDT2D.computeNarrowBand(mask, Rect(0, 0, mask.cols, mask.rows), sdt, NULL, 0);
         
         Mat heaviside;
-        parallel_for_(cv::Range(0, 8), Parallel_For_convertToHeaviside(sdt, heaviside, 8));
-        
-        heavisidePyramid[level] = heaviside;
+        int chunks = ThreadPool::Instance()->NumChunks(sdt.rows);
+        ThreadPool::Instance()->ParallelFor(cv::Range(0, chunks), Parallel_For_convertToHeaviside(sdt, heaviside, chunks));
         
         compressTemplateData(centersIDs, heaviside, roi, tclcHistograms->getRadius(), level);
+        
+        // keep only as much of the images as requested, matching uses the compressed pixel data
+        if(images >= 2)
+        {
+            maskPyramid[level] = mask*255;
+            sdtPyramid[level] = sdt;
+            heavisidePyramid[level] = heaviside;
+        }
+        else if(images == 1)
+        {
+            sdt.convertTo(sdtPyramid[level], CV_16S, kSDTScale);
+            
+            heaviside.convertTo(heavisidePyramid[level], CV_8U, kHeavisideOutside - 1);
+            heavisidePyramid[level].setTo(kHeavisideOutside, heaviside < 0.0f);
+        }
     }
 }
 
 
+TemplateView::TemplateView()
+{
+    view = View::Instance();
+    
+    T_cm = Matx44f::eye();
+    
+    _alpha = 0;
+    _beta = 0;
+    _gamma = 0;
+    
+    _distance = 0;
+    
+    _numLevels = 0;
+}
+
+
 TemplateView::~TemplateView()
 {
-    for(int i = 0; i < pixelDataPyramid.size(); i++)
-    {
-        for(int j = 0; j < pixelDataPyramid[i].size(); j++)
-        {
-            delete[] pixelDataPyramid[i][j].ids;
-        }
-        pixelDataPyramid[i].clear();
-    }
-    pixelDataPyramid.clear();
 }
 
 Matx44f TemplateView::getPoseMatrix()
@@ -137,12 +169,43 @@ Mat TemplateView::getMask(int level)
 
 Mat TemplateView::getSDT(int level)
 {
-    return sdtPyramid[level];
+    Mat sdt = sdtPyramid[level];
+    if(sdt.type() == CV_16SC1)
+    {
+        sdt.convertTo(sdt, CV_32F, 1.0f/kSDTScale);
+    }
+    return sdt;
 }
 
 Mat TemplateView::getHeaviside(int level)
 {
-    return heavisidePyramid[level];
+    Mat heaviside = heavisidePyramid[level];
+    if(heaviside.type() == CV_8UC1)
+    {
+        Mat lut(1, 256, CV_32FC1);
+        for(int i = 0; i < 256; i++)
+        {
+            lut.at<float>(i) = (i == kHeavisideOutside) ? -1.0f : i/float(kHeavisideOutside - 1);
+        }
+        Mat values;
+        LUT(heaviside, lut, values);
+        return values;
+    }
+    return heaviside;
+}
+
+size_t TemplateView::getMemory()
+{
+    size_t memory = 0;
+    for(int level = 0; level < _numLevels; level++)
+    {
+        memory += maskPyramid[level].total()*maskPyramid[level].elemSize();
+        memory += sdtPyramid[level].total()*sdtPyramid[level].elemSize();
+        memory += heavisidePyramid[level].total()*heavisidePyramid[level].elemSize();
+        memory += centersIDsPyramid[level].size()*sizeof(Point3i);
+        memory += pixelDataPyramid[level].getMemory();
+    }
+    return memory;
 }
 
 Rect TemplateView::getROI(int level)
@@ -166,7 +229,7 @@ vector<Point3i> TemplateView::getCentersAndIDs(int level)
 }
 
 
-std::vector<PixelData>& TemplateView::getCompressedPixelData(int level)
+const CompressedPixelData& TemplateView::getCompressedPixelData(int level)
 {
     return pixelDataPyramid[level];
 }
@@ -181,58 +244,246 @@ std::vector<TemplateView*> TemplateView::getNeighborTemplates()
     return neighbors;
 }
 
-void TemplateView::compressTemplateData(const std::vector<cv::Point3i>& centersIDs, const cv::Mat &heaviside, const cv::Rect& roi, int radius, int level)
+namespace
 {
-    int numHistograms = (int)centersIDs.size();
-    int scale = pow(2, level);
-    int radius2 = radius*radius;
+
+/**
+ *  The histogram centers bucketed into a uniform grid, with the indices of the
+ *  centers of every cell in ascending order.
+ */
+struct CenterGrid
+{
+    float xMin, yMin;
+    float cellSize;
+    int cols, rows;
+    
+    std::vector<int> cellStarts;
+    std::vector<int> items;
+    
+    void build(const std::vector<cv::Point3i> &centersIDs, float size)
+    {
+        cellSize = size;
+        
+        xMin = (float)centersIDs[0].x;
+        yMin = (float)centersIDs[0].y;
+        float xMax = xMin, yMax = yMin;
+        for(int h = 1; h < centersIDs.size(); h++)
+        {
+            xMin = min(xMin, (float)centersIDs[h].x);
+            yMin = min(yMin, (float)centersIDs[h].y);
+            xMax = max(xMax, (float)centersIDs[h].x);
+            yMax = max(yMax, (float)centersIDs[h].y);
+        }
+        
+        cols = (int)((xMax - xMin)/cellSize) + 1;
+        rows = (int)((yMax - yMin)/cellSize) + 1;
+        
+        // counting sort keeps the centers of a cell in their original order
+        cellStarts.assign(cols*rows + 1, 0);
+        for(int h = 0; h < centersIDs.size(); h++)
+        {
+            cellStarts[cell(centersIDs[h]) + 1]++;
+        }
+        for(int c = 0; c < cols*rows; c++)
+        {
+            cellStarts[c + 1] += cellStarts[c];
+        }
+        
+        items.resize(centersIDs.size());
+        std::vector<int> fill(cellStarts.begin(), cellStarts.end() - 1);
+        for(int h = 0; h < centersIDs.size(); h++)
+        {
+            items[fill[cell(centersIDs[h])]++] = h;
+        }
+    }
+    
+    int cell(const cv::Point3i &center) const
+    {
+        int gx = (int)((center.x - xMin)/cellSize);
+        int gy = (int)((center.y - yMin)/cellSize);
+        return gy*cols + gx;
+    }
+    
+    // the range of cells covering [v0, v1] along one axis, empty if outside of the grid
+    static void cellRange(float v0, float v1, float vMin, float cellSize, int num, int &c0, int &c1)
+    {
+        c0 = max((int)floor((v0 - vMin)/cellSize), 0);
+        c1 = min((int)floor((v1 - vMin)/cellSize), num - 1);
+    }
+};
+
+/**
+ *  The compressed pixel data of a range of rows, merged in row order afterwards.
+ */
+struct CompressedChunk
+{
+    std::vector<unsigned short> x;
+    std::vector<unsigned short> y;
+    std::vector<unsigned char> hsVal;
+    std::vector<int> counts;
+    std::vector<int> ids;
+    int maxID;
+};
+
+}
+
+
+/**
+ *  This class extends the OpenCV ParallelLoopBody for efficiently parallelized
+ *  computations. Within the corresponding for loop, the tclc-histograms every
+ *  Heaviside pixel of a template lies within are looked up in the cells of a
+ *  center grid around it, instead of testing all centers, and the pixels that
+ *  lie within more than one histogram are written to the buffer of their chunk.
+ */
+class Parallel_For_compressTemplateData: public cv::ParallelLoopBody
+{
+private:
+    const std::vector<cv::Point3i> &_centersIDs;
+    const CenterGrid &_grid;
+    
+    cv::Mat _heaviside;
+    cv::Rect _roi;
+    
+    int _scale;
+    int _radius;
+    
+    CompressedChunk *_chunks;
+    
+    int _threads;
     
-    float *hsData = (float*)heaviside.ptr<float>();
+public:
+    Parallel_For_compressTemplateData(const std::vector<cv::Point3i> &centersIDs, const CenterGrid &grid, const cv::Mat &heaviside, const cv::Rect &roi, int scale, int radius, std::vector<CompressedChunk> &chunks, int threads)
+        : _centersIDs(centersIDs), _grid(grid)
+    {
+        _heaviside = heaviside;
+        _roi = roi;
+        
+        _scale = scale;
+        _radius = radius;
+        
+        _chunks = chunks.data();
+        
+        _threads = threads;
+    }
     
-    for(int j = 0; j < roi.height; j++)
+    virtual void operator()( const cv::Range &r ) const
     {
-        int idx = j*roi.width;
+        int range = _roi.height/_threads;
+        int radius2 = _radius*_radius;
         
-        for(int i = 0; i < roi.width; i++, idx++)
+        for(int t = r.start; t < r.end; t++)
         {
-            float hsVal = hsData[idx];
+            int yBegin = t*range;
+            int yEnd = (t + 1 == _threads) ? _roi.height : yBegin + range;
+            
+            CompressedChunk &chunk = _chunks[t];
+            chunk.maxID = 0;
             
-            if(hsVal >= 0.0f)
+            for(int j = yBegin; j < yEnd; j++)
             {
-                vector<int> ids;
-                for(int h = 0; h < numHistograms; h++)
+                const float *hsRow = _heaviside.ptr<float>(j);
+                
+                // the distances are truncated towards zero, so centers up to one pixel beyond the radius can still count
+                float py = _scale*(j + _roi.y + 0.5f);
+                int gy0, gy1;
+                CenterGrid::cellRange(py - _radius - 1, py + _radius + 1, _grid.yMin, _grid.cellSize, _grid.rows, gy0, gy1);
+                
+                for(int i = 0; i < _roi.width; i++)
                 {
-                    cv::Point3i centerID = centersIDs[h];
-                    int dx = centerID.x - scale*(i+roi.x + 0.5f);
-                    int dy = centerID.y - scale*(j+roi.y + 0.5f);
+                    float hsVal = hsRow[i];
+                    if(hsVal < 0.0f)
+                        continue;
                     
-                    int distance = dx*dx + dy*dy;
+                    float px = _scale*(i + _roi.x + 0.5f);
+                    int gx0, gx1;
+                    CenterGrid::cellRange(px - _radius - 1, px + _radius + 1, _grid.xMin, _grid.cellSize, _grid.cols, gx0, gx1);
                     
-                    if(distance <= radius2)
+                    int numIDs = 0;
+                    for(int gy = gy0; gy <= gy1; gy++)
                     {
-                        ids.push_back(centerID.z);
+                        for(int gx = gx0; gx <= gx1; gx++)
+                        {
+                            int c = gy*_grid.cols + gx;
+                            for(int k = _grid.cellStarts[c]; k < _grid.cellStarts[c + 1]; k++)
+                            {
+                                const cv::Point3i &centerID = _centersIDs[_grid.items[k]];
+                                int dx = centerID.x - px;
+                                int dy = centerID.y - py;
+                                
+                                if(dx*dx + dy*dy <= radius2)
+                                {
+                                    chunk.ids.push_back(centerID.z);
+                                    chunk.maxID = max(chunk.maxID, centerID.z);
+                                    numIDs++;
+                                }
+                            }
+                        }
                     }
-                }
-                
-                if(ids.size() > 1)
-                {
-                    PixelData pixelData;
-                    pixelData.x = i;
-                    pixelData.y = j;
-                    pixelData.hsVal = hsVal;
-                    pixelData.ids_size = (int)ids.size();
-                    pixelData.ids = new int[pixelData.ids_size];
                     
-                    for(int k = 0; k < ids.size(); k++)
+                    if(numIDs > 1)
                     {
-                        pixelData.ids[k] = ids[k];
+                        chunk.x.push_back((unsigned short)i);
+                        chunk.y.push_back((unsigned short)j);
+                        chunk.hsVal.push_back((unsigned char)(hsVal*255.0f + 0.5f));
+                        chunk.counts.push_back(numIDs);
+                    }
+                    else
+                    {
+                        chunk.ids.resize(chunk.ids.size() - numIDs);
                     }
-                    
-                    pixelDataPyramid[level].push_back(pixelData);
                 }
             }
         }
     }
+};
+
+
+void TemplateView::compressTemplateData(const std::vector<cv::Point3i>& centersIDs, const cv::Mat &heaviside, const cv::Rect& roi, int radius, int level)
+{
+    int scale = pow(2, level);
+    
+    CompressedPixelData &pixelData = pixelDataPyramid[level];
+    pixelData.offsets.push_back(0);
+    
+    if(centersIDs.empty() || roi.height <= 0)
+        return;
+    
+    // cells as large as the radius, so a pixel only looks at the 3x3 or 4x4 cells around it
+    CenterGrid grid;
+    grid.build(centersIDs, (float)max(radius, 1));
+    
+    ThreadPool* pool = ThreadPool::Instance();
+    int threads = pool->NumChunks(roi.height, 4);
+    
+    std::vector<CompressedChunk> chunks(threads);
+    pool->ParallelFor(cv::Range(0, threads), Parallel_For_compressTemplateData(centersIDs, grid, heaviside, roi, scale, radius, chunks, threads));
+    
+    int maxID = 0;
+    for(const CompressedChunk &chunk : chunks)
+    {
+        pixelData.x.insert(pixelData.x.end(), chunk.x.begin(), chunk.x.end());
+        pixelData.y.insert(pixelData.y.end(), chunk.y.begin(), chunk.y.end());
+        pixelData.hsVal.insert(pixelData.hsVal.end(), chunk.hsVal.begin(), chunk.hsVal.end());
+        pixelData.ids32.insert(pixelData.ids32.end(), chunk.ids.begin(), chunk.ids.end());
+        
+        for(int count : chunk.counts)
+        {
+            pixelData.offsets.push_back(pixelData.offsets.back() + count);
+        }
+        
+        maxID = max(maxID, chunk.maxID);
+    }
+    
+    // narrow the IDs if they all fit into 16 bits
+    if(maxID <= USHRT_MAX)
+    {
+        pixelData.ids16.assign(pixelData.ids32.begin(), pixelData.ids32.end());
+        vector<int>().swap(pixelData.ids32);
+    }
+    else
+    {
+        pixelData.ids32.shrink_to_fit();
+    }
 }
 
 cv::Rect TemplateView::computeBoundingBox(const std::vector<cv::Point3i> &centersIDs, int offset, int level, const cv::Size &maxSize)
@@ -266,3 +517,20 @@ cv::Rect TemplateView::computeBoundingBox(const std::vector<cv::Point3i> &center
     
     return Rect(minX, minY, maxX - minX, maxY - minY);
 }
+
+
+size_t CompressedPixelData::getMemory() const
+{
+    return x.size()*sizeof(unsigned short) + y.size()*sizeof(unsigned short) + hsVal.size()*sizeof(unsigned char)
+        + offsets.size()*sizeof(int) + ids16.size()*sizeof(unsigned short) + ids32.size()*sizeof(int);
+}
+
+size_t CompressedPixelData::getPerPixelMemory() const
+{
+    // a record of x, y, hsVal, the ID count and the ID pointer, and the ID array with typical allocator overhead
+    const size_t recordSize = 4*sizeof(int) + sizeof(int*);
+    const size_t allocationOverhead = 16;
+    
+    size_t numIDs = offsets.empty() ? 0 : offsets.back();
+    return x.size()*(recordSize + allocationOverhead) + numIDs*sizeof(int);
+}
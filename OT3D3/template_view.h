@@ -11,22 +11,42 @@
 #include "signed_distance_transform2d.h"
 
 /**
- *  The template view data per pixel.
+ *  The template view data of all compressed pixels of one pyramid level in
+ *  CSR form. The tclc-histogram IDs of pixel i are ids[offsets[i]] up to
+ *  ids[offsets[i+1]-1]. The IDs are stored with 16 bits if all of them fit.
  */
-struct PixelData
+struct CompressedPixelData
 {
-    // The original 2D pixel location.
-    int x;
-    int y;
+    // The original 2D pixel locations.
+    std::vector<unsigned short> x;
+    std::vector<unsigned short> y;
     
-    // The Heaviside value.
-    float hsVal;
+    // The Heaviside values quantized to 1/255.
+    std::vector<unsigned char> hsVal;
     
-    // The number of tclc-histograms the pixel lies within.
-    int ids_size;
+    // The start of the IDs of every pixel, followed by the total number of IDs.
+    std::vector<int> offsets;
     
-    // The IDs of all tclc-histograms the pixel lies within.
-    int* ids;
+    // The IDs of all tclc-histograms the pixels lie within, only one of them is used.
+    std::vector<unsigned short> ids16;
+    std::vector<int> ids32;
+    
+    int size() const { return (int)x.size(); }
+    
+    float getHsVal(int i) const { return hsVal[i]*(1.0f/255.0f); }
+    
+    int getId(int k) const { return ids32.empty() ? ids16[k] : ids32[k]; }
+    
+    /**
+     *  Returns the number of bytes used by the arrays.
+     */
+    size_t getMemory() const;
+    
+    /**
+     *  Returns the number of bytes the same pixels took as one record with
+     *  a separately allocated ID array each.
+     */
+    size_t getPerPixelMemory() const;
 };
 
 /**
@@ -112,7 +132,7 @@ public:
      *  level.
      *
      *  @param level The pyramid level to be used.
-     *  @return  The binary mask image of the template.
+     *  @return  The binary mask image of the template, empty unless templateImages is 2.
      */
     cv::Mat getMask(int level);
     
@@ -121,7 +141,7 @@ public:
      *  template at a given pyramid level.
      *
      *  @param level The pyramid level to be used.
-     *  @return  The 2D signed distance transform of the binary mask of the template.
+     *  @return  The 2D signed distance transform of the binary mask of the template (float), empty if templateImages is 0.
      */
     cv::Mat getSDT(int level);
     
@@ -130,10 +150,18 @@ public:
      *  transform of the template at a given pyramid level.
      *
      *  @param level The pyramid level to be used.
-     *  @return  The smoothed Heaviside representation of the 2D signed distance transform of the template.
+     *  @return  The smoothed Heaviside representation of the 2D signed distance transform of the template (float), empty if templateImages is 0.
      */
     cv::Mat getHeaviside(int level);
     
+    /**
+     *  Returns the number of bytes used by the images, the histogram centers
+     *  and the compressed pixel data of all pyramid levels.
+     *
+     *  @return  The memory used by the template.
+     */
+    size_t getMemory();
+    
     /**
      *  Returns the 2D region of interest around the object in the template at
      *  a given pyramid level.
@@ -177,7 +205,7 @@ public:
      *  @param level The pyramid level to be used.
      *  @return  The linearized representation of the template.
      */
-    std::vector<PixelData> &getCompressedPixelData(int level);
+    const CompressedPixelData &getCompressedPixelData(int level);
     
     /**
      *  Adds a neighboring template view to this template.
@@ -194,11 +222,20 @@ public:
     std::vector<TemplateView*> getNeighborTemplates();
     
 private:
+    friend class TemplateCache;
+    
+    /**
+     *  Constructor for an empty template view that is filled from a template cache.
+     */
+    TemplateView();
+    
     View *view;
     
     cv::Matx44f T_cm;
     
     std::vector<int> etaFPyramid;
+    
+    // depending on templateImages none, 16 bit fixed point SDTs and 8 bit Heaviside images, or all as float
     std::vector<cv::Mat> maskPyramid;
     std::vector<cv::Mat> sdtPyramid;
     std::vector<cv::Mat> heavisidePyramid;
@@ -207,7 +244,7 @@ private:
     
     std::vector<std::vector<cv::Point3i> > centersIDsPyramid;
     
-    std::vector<std::vector<PixelData> > pixelDataPyramid;
+    std::vector<CompressedPixelData> pixelDataPyramid;
     
     cv::Point3f currentOffset;
     
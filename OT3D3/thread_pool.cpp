@@ -0,0 +1,258 @@
+#include <algorithm>
+
+#include "global_params.h"
+#include "thread_pool.h"
+
+ThreadPool* ThreadPool::instance = NULL;
+
+// true while the current thread executes a task of the pool
+static thread_local bool in_task = false;
+
+ThreadPool* ThreadPool::Instance() {
+	if (instance == NULL) {
+		instance = new ThreadPool();
+	}
+	return instance;
+}
+
+ThreadPool::ThreadPool() : queued(0), background_queued(0), background_running(0), max_background(1), stop(false), next_queue(0) {
+	SetNumThreads(OT3D::GlobalParam::Instance()->threads);
+}
+
+ThreadPool::~ThreadPool() {
+	Stop();
+}
+
+void ThreadPool::SetNumThreads(int num_threads) {
+	if (num_threads <= 0)
+		num_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+
+	Stop();
+	// the calling thread is the last one
+	Start(num_threads - 1);
+}
+
+int ThreadPool::GetNumThreads() const {
+	return (int)workers.size() + 1;
+}
+
+int ThreadPool::NumChunks(int work, int min_work) const {
+	// a few chunks per thread leave room for stealing
+	int chunks = std::min(work / std::max(min_work, 1), 4 * GetNumThreads());
+	return std::max(chunks, 1);
+}
+
+void ThreadPool::Start(int num_workers) {
+	stop = false;
+	queued = 0;
+	background_queued = 0;
+	background_running = 0;
+	max_background = std::max(OT3D::GlobalParam::Instance()->backgroundThreads, 1);
+
+	queues.clear();
+	for (int i = 0; i < std::max(num_workers, 1); i++) {
+		queues.emplace_back(new Queue());
+	}
+
+	for (int i = 0; i < num_workers; i++) {
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+void ThreadPool::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stop = true;
+	}
+	wake.notify_all();
+
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void ThreadPool::ParallelFor(const cv::Range& range, const cv::ParallelLoopBody& body) {
+	Run(range, body, false);
+}
+
+void ThreadPool::ParallelForBackground(const cv::Range& range, const cv::ParallelLoopBody& body) {
+	Run(range, body, true);
+}
+
+void ThreadPool::Run(const cv::Range& range, const cv::ParallelLoopBody& body, bool background) {
+	int num = range.end - range.start;
+	if (num <= 0)
+		return;
+
+	if (num == 1 || workers.empty() || in_task) {
+		for (int i = range.start; i < range.end; i++) {
+			body(cv::Range(i, i + 1));
+		}
+		return;
+	}
+
+	Job job;
+	job.pending = num;
+
+	int first = next_queue.fetch_add(1);
+	if (background) {
+		std::lock_guard<std::mutex> lock(background_queue.mutex);
+		for (int i = 0; i < num; i++) {
+			background_queue.tasks.push_back({ &body, range.start + i, &job, true });
+		}
+	}
+	else {
+		for (int i = 0; i < num; i++) {
+			Queue& queue = *queues[(first + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back({ &body, range.start + i, &job, false });
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		(background ? background_queued : queued) += num;
+	}
+	wake.notify_all();
+
+	// run the own tasks that no worker took yet, then wait for the running ones;
+	// tasks of other jobs are left alone, they may take much longer than this one.
+	// A background loop leaves its core to the tracking and only waits
+	Task task;
+	while (!background && job.pending > 0 && PopJobTask(&job, first % (int)queues.size(), task)) {
+		RunTask(task);
+	}
+
+	std::unique_lock<std::mutex> lock(job.mutex);
+	job.done.wait(lock, [&job] { return job.pending == 0; });
+
+	if (job.error)
+		std::rethrow_exception(job.error);
+}
+
+void ThreadPool::WorkerLoop(int wid) {
+	Task task;
+	while (true) {
+		if (PopTask(wid, task)) {
+			RunTask(task);
+
+			if (task.background) {
+				// another worker may wait for the background slot
+				{
+					std::lock_guard<std::mutex> lock(wake_mutex);
+					background_running--;
+				}
+				wake.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		wake.wait(lock, [this] { return stop || queued > 0 || (background_queued > 0 && background_running < max_background); });
+		if (stop)
+			return;
+	}
+}
+
+bool ThreadPool::PopTask(int wid, Task& task) {
+	// the own queue is processed from the back, the others are robbed from the front
+	{
+		Queue& queue = *queues[wid];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	for (int i = 1; i < queues.size(); i++) {
+		Queue& queue = *queues[(wid + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			queued--;
+			return true;
+		}
+	}
+
+	// background tasks only when nothing else is queued and a background slot is free
+	int running = background_running;
+	do {
+		if (running >= max_background || background_queued <= 0)
+			return false;
+	} while (!background_running.compare_exchange_weak(running, running + 1));
+
+	{
+		std::lock_guard<std::mutex> lock(background_queue.mutex);
+		if (!background_queue.tasks.empty()) {
+			task = background_queue.tasks.front();
+			background_queue.tasks.pop_front();
+			background_queued--;
+			return true;
+		}
+	}
+
+	// the calling thread took the last one in the meantime
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		background_running--;
+	}
+	wake.notify_all();
+
+	return false;
+}
+
+bool ThreadPool::PopJobTask(const Job* job, int wid, Task& task) {
+	for (int i = 0; i < queues.size(); i++) {
+		Queue& queue = *queues[(wid + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		auto it = std::find_if(queue.tasks.begin(), queue.tasks.end(), [job](const Task& t) { return t.job == job; });
+		if (it != queue.tasks.end()) {
+			task = *it;
+			queue.tasks.erase(it);
+			queued--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+namespace {
+
+// marks the current thread as running a task and restores the previous state on any exit
+class InTaskGuard {
+public:
+	InTaskGuard() : previous(in_task) { in_task = true; }
+	~InTaskGuard() { in_task = previous; }
+
+private:
+	bool previous;
+};
+
+}
+
+void ThreadPool::RunTask(const Task& task) {
+	// a throwing body must still finish its task, otherwise the caller waits forever
+	std::exception_ptr error;
+	{
+		InTaskGuard guard;
+		try {
+			(*task.body)(cv::Range(task.index, task.index + 1));
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+	}
+
+	// the job lives on the stack of its caller, which may return as soon as pending is 0
+	std::lock_guard<std::mutex> lock(task.job->mutex);
+	if (error && !task.job->error)
+		task.job->error = error;
+	if (--task.job->pending == 0)
+		task.job->done.notify_all();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+/**
+ *  A persistent work-stealing thread pool shared by all Parallel_For_* kernels.
+ *  Every index of a range is queued as its own task, spread round-robin over the
+ *  worker queues. Idle workers steal from the others, and the calling thread
+ *  helps with the tasks of its own range until all of them have been processed,
+ *  so a long loop of another thread never delays it. The number of threads is
+ *  taken from the |threads| config value on first use.
+ *
+ *  Loops of background threads go to a separate queue, which workers only serve
+ *  when no other task is queued, and only |backgroundThreads| of them at once.
+ *  The per-frame loops of the tracker therefore always find free workers.
+ */
+class ThreadPool {
+public:
+	static ThreadPool* Instance();
+
+	~ThreadPool();
+
+	/**
+	 *  Restarts the pool with the given number of threads including the calling one,
+	 *  0 uses all hardware threads. Must not be called while a loop is running.
+	 */
+	void SetNumThreads(int num_threads);
+	int GetNumThreads() const;
+
+	/**
+	 *  Number of chunks a kernel should split |work| items into: enough to keep every
+	 *  thread busy under load imbalance, but no chunk smaller than |min_work| items.
+	 */
+	int NumChunks(int work, int min_work = 16) const;
+
+	/**
+	 *  Calls body(cv::Range(i, i + 1)) for every i in range and returns when all of them
+	 *  finished. Nested calls from inside a task run sequentially on the calling thread.
+	 *  If a call of the body throws, the remaining ones still run and the first exception
+	 *  is rethrown on the calling thread.
+	 */
+	void ParallelFor(const cv::Range& range, const cv::ParallelLoopBody& body);
+
+	/**
+	 *  Like ParallelFor, but queued at a lower priority for loops that run beside the
+	 *  tracking. The tasks are spread over at most |backgroundThreads| workers, while the
+	 *  calling thread only waits. Runs on the calling thread if the pool has no workers.
+	 */
+	void ParallelForBackground(const cv::Range& range, const cv::ParallelLoopBody& body);
+
+protected:
+	ThreadPool();
+
+private:
+	struct Job {
+		std::atomic<int> pending;
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr error;	// the first exception thrown by a task
+	};
+
+	struct Task {
+		const cv::ParallelLoopBody* body;
+		int index;
+		Job* job;
+		bool background;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void Start(int num_workers);
+	void Stop();
+
+	void Run(const cv::Range& range, const cv::ParallelLoopBody& body, bool background);
+
+	void WorkerLoop(int wid);
+	bool PopTask(int wid, Task& task);
+	bool PopJobTask(const Job* job, int wid, Task& task);
+	void RunTask(const Task& task);
+
+	static ThreadPool* instance;
+
+	std::vector<std::unique_ptr<Queue> > queues;
+	Queue background_queue;
+	std::vector<std::thread> workers;
+
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+	std::atomic<int> queued;
+	std::atomic<int> background_queued;
+	std::atomic<int> background_running;	// workers running a background task
+	int max_background;
+	bool stop;
+
+	std::atomic<int> next_queue;
+};
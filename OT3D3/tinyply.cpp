@@ -333,11 +333,16 @@ void PlyFile::read_internal(std::istream & is)
 							size_t listSize = 0;
 							size_t dummyCount = 0;
                             read(property.listType, &listSize, dummyCount, is);
+                            if (cursor->listCount != 0 && listSize != cursor->listCount)
+                                throw std::runtime_error("list has another size than the requested count");
                             if (cursor->realloc == false)
                             {
                                 cursor->realloc = true;
                                 resize_vector(property.propertyType, cursor->vector, listSize * element.size, cursor->data);
+                                cursor->capacity = listSize * element.size * PropertyTable[property.propertyType].stride;
                             }
+                            if (cursor->offset + listSize * PropertyTable[property.propertyType].stride > cursor->capacity)
+                                throw std::runtime_error("list is longer than the requested count");
                             for (size_t i = 0; i < listSize; ++i)
                             {
                                 read(property.propertyType, (cursor->data + cursor->offset), cursor->offset, is);
@@ -47,6 +47,8 @@ namespace tinyply
 		void * vector;
 		uint8_t * data;
 		size_t offset;
+		size_t capacity = 0;  // bytes of the destination vector
+		size_t listCount = 0;  // the size every list must have, 0: any
 		bool realloc = false;
 	};
 
@@ -302,10 +304,12 @@ namespace tinyply
 			cursor->offset = 0;
 			cursor->vector = &source;
 			cursor->data = reinterpret_cast<uint8_t *>(source.data());
+			cursor->capacity = source.size() * sizeof(T);
 
 			if (listCount > 1)
 			{
 				cursor->realloc = true;
+				cursor->listCount = listCount;
 				return (totalInstanceSize / propertyKeys.size()) / listCount;
 			}
 
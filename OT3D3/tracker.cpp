@@ -6,10 +6,13 @@
 
 #include "view.h"
 #include "tracker.h"
+#include "global_params.h"
+#include "transformations.h"
 #include "object3d.h"
 #include "histogram.h"
 #include "search_line.h"
 #include "tracker_slc.h"
+#include "tracker_sparse_slc.h"
 
 Tracker::Tracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vector<Object3D*>& objects) {
 	initialized = false;
@@ -24,7 +27,6 @@ Tracker::Tracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vecto
 		objects[i]->setModelID(i + 1);
 		this->objects.push_back(objects[i]);
 		this->objects[i]->initBuffers();
-		//this->objects[i]->generateTemplates();
 		this->objects[i]->reset();
 	}
 
@@ -33,23 +35,56 @@ Tracker::Tracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vecto
 	jac_time	= 0;
 	sc_time		= 0;
 	pp_time		= 0;
+
+	iter_count	= 0;
+
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+	motion_prediction = gp->motionPrediction != 0;
+	motion_damping = gp->motionDamping;
+	// the relocalization only searches objects that have been marked as lost
+	loss_detection = gp->lossDetection != 0 || gp->relocalization != 0;
+
+	timer.SetRecordEvents(gp->traceEvents != 0);
+	frame_count = 0;
 }
 
 Tracker* Tracker::GetTracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vector<Object3D*>& objects) {
 	Tracker* poseEstimator = NULL;
 
-	poseEstimator = new SLCTracker(K, distCoeffs, objects);
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+	switch (gp->trackerMode) {
+	case 0:
+		poseEstimator = new SLCTracker(K, distCoeffs, objects);
+		break;
+	case 1:
+		poseEstimator = new SparseSLCTracker(K, distCoeffs, objects);
+		break;
+	default:
+		break;
+	}
+
+	CHECK(poseEstimator) << "Check |trackerMode| in yml file";
+
+	// the templates need the tclc-histograms, which the trackers create
+	if (gp->relocalization != 0) {
+		for (auto object : objects) {
+			object->generateTemplates();
+			object->reset();
+		}
+	}
 
-	CHECK(poseEstimator) << "Check |tracker_mode| in yml file";
 	return poseEstimator;
 }
 
-void Tracker::reset() {
+void Tracker::reset(int first_frame) {
 	for (int i = 0; i < objects.size(); i++) {
 		objects[i]->reset();
 	}
 
 	initialized = false;
+
+	timer.Reset();
+	frame_count = first_frame;
 }
 
 void Tracker::CheckPose(std::vector<Object3D*>& objects) {
@@ -113,6 +148,44 @@ void Tracker::CheckPose(std::vector<Object3D*>& objects) {
 	}
 }
 
+void Tracker::UpdateTrackingLoss(std::vector<Object3D*>& objects) {
+	if (!loss_detection)
+		return;
+
+	for (auto object : objects) {
+		float quality = object->getTrackingQuality();
+		if (!object->isInitialized() || quality < 0.0f)
+			continue;
+
+		bool lost = quality < object->getQualityThreshold();
+		if (lost != object->isTrackingLost())
+			LOG(INFO) << "tracking quality " << quality << (lost ? ", lost object " : ", recovered object ") << object->getModelID();
+
+		object->setTrackingLost(lost);
+	}
+}
+
+void Tracker::PredictPoses(std::vector<Object3D*>& objects) {
+	for (auto object : objects) {
+		if (!object->isInitialized())
+			continue;
+
+		cv::Matx44f T_cm = object->getPose();
+		cv::Matx44f T_pm = object->getPrePose();
+
+		// keep the pre-pose up to date even when the prediction is switched off,
+		// so that enabling it at runtime does not extrapolate from a stale pose
+		object->setPrePose(T_cm);
+
+		if (!motion_prediction)
+			continue;
+
+		// constant-velocity twist between the last two frames: T_cm = exp(xi) * T_pm
+		cv::Matx61f xi = Transformations::log(T_cm * T_pm.inv());
+		object->setPose(Transformations::exp(motion_damping * xi) * T_cm);
+	}
+}
+
 //std::vector<std::vector<cv::Point> > contours;
 //cv::findContours(mask_map, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
 //std::vector<cv::Point3f> pts3d;
@@ -145,6 +218,8 @@ void Tracker::ToggleTracking(cv::Mat& frame, int objectIndex, bool undistortFram
 
 void Tracker::EstimatePoses(cv::Mat frame, bool undistortFrame)
 {
+	timer.BeginFrame(frame_count++);
+
 	if (undistortFrame)
 	{
 		// Remap the input image to undistort
@@ -161,9 +236,21 @@ void Tracker::EstimatePoses(cv::Mat frame, bool undistortFrame)
 	}
 
 	if (initialized) {
+		PredictPoses(objects);
 		Track(imagePyramid, objects);
+		UpdateTrackingLoss(objects);
 		//CheckPose(objects);
 	}
+
+	UpdateStageTimes();
+}
+
+void Tracker::UpdateStageTimes() {
+	render_time = int64(timer.FrameTime(StageTimer::RENDER) + timer.FrameTime(StageTimer::READBACK));
+	sl_time = int64(timer.FrameTime(StageTimer::SEARCH_LINE) + timer.FrameTime(StageTimer::BUNDLE));
+	sc_time = int64(timer.FrameTime(StageTimer::MATCH));
+	jac_time = int64(timer.FrameTime(StageTimer::JACOBIAN) + timer.FrameTime(StageTimer::SOLVE));
+	pp_time = int64(timer.FrameTime(StageTimer::HISTOGRAM));
 }
 
 cv::Rect Tracker::Compute2DROI(Object3D* object, const cv::Size& maxSize, int offset) {
@@ -318,14 +405,31 @@ void TrackerBase::PostProcess(cv::Mat frame) {
 void TrackerBase::UpdateHist(cv::Mat frame) {
 	float afg = 0.1f, abg = 0.2f;
 	if (initialized) {
-		view->setLevel(0);
-		view->RenderSilhouette(std::vector<Model*>(objects.begin(), objects.end()), GL_FILL);
-		cv::Mat masks_map = view->DownloadFrame(View::MASK);
-		cv::Mat depth_map = view->DownloadFrame(View::DEPTH);
+		{
+			StageTimer::Scope scope(timer, StageTimer::RENDER);
+			view->setLevel(0);
+			view->RenderSilhouette(std::vector<Model*>(objects.begin(), objects.end()), GL_FILL);
+		}
 
-		for (int oid = 0; oid < objects.size(); oid++) {
-			hists->Update(frame, masks_map, depth_map, oid, afg, abg);
+		cv::Mat masks_map, depth_map;
+		{
+			StageTimer::Scope scope(timer, StageTimer::READBACK);
+			masks_map = view->DownloadFrame(View::MASK);
+			depth_map = view->DownloadFrame(View::DEPTH);
 		}
+
+		{
+			StageTimer::Scope scope(timer, StageTimer::HISTOGRAM);
+			for (int oid = 0; oid < objects.size(); oid++) {
+				// the silhouette of a lost object is wrong, and the relocalization reads its histograms
+				if (objects[oid]->isTrackingLost())
+					continue;
+
+				hists->Update(frame, masks_map, depth_map, oid, afg, abg);
+			}
+		}
+
+		UpdateStageTimes();
 	}
 }
 
@@ -519,4 +623,31 @@ void SLTracker::FilterOccludedPoint(const cv::Mat& mask, const cv::Mat& depth) {
 			search_line->actives[r] = 0;
 		}
 	}
-}
\ No newline at end of file
+}
+
+float SLTracker::ComputeQuality() const {
+	const std::vector<std::vector<cv::Point> >& search_points = search_line->search_points;
+	const std::vector<std::vector<cv::Point2f> >& bundle_prob = search_line->bundle_prob;
+
+	float sum = 0.0f;
+	int num_active = 0;
+	for (int r = 0; r < bundle_prob.size(); ++r) {
+		if (!search_line->actives[r])
+			continue;
+
+		num_active++;
+
+		// the lines run from the background into the object, the edge lies between the two sides
+		int eid = search_points[r][search_points[r].size() - 1].y;
+		if (eid < 3 || eid + 3 >= bundle_prob[r].size()) {
+			sum += 0.5f;
+			continue;
+		}
+
+		float outer = bundle_prob[r][eid - 3].x + bundle_prob[r][eid - 2].x + bundle_prob[r][eid - 1].x;
+		float inner = bundle_prob[r][eid + 1].x + bundle_prob[r][eid + 2].x + bundle_prob[r][eid + 3].x;
+		sum += 0.5f + (inner - outer) / 6.0f;
+	}
+
+	return num_active ? sum / num_active : -1.0f;
+}
@@ -5,6 +5,7 @@
 #include "object3d.h"
 #include "signed_distance_transform2d.h"
 #include "template_view.h"
+#include "stage_timer.h"
 
 class Viewer;
 
@@ -19,18 +20,34 @@ public:
 	virtual void PreProcess(cv::Mat frame) {}
 	virtual void PostProcess(cv::Mat frame) {}
 
-	void reset();
+	/**
+	 *  Resets the objects to their initial poses and clears the stage timer, e.g. before a
+	 *  new input sequence. The next frame passed to EstimatePoses() gets the id first_frame.
+	 */
+	void reset(int first_frame = 0);
 
-	int64 render_time;
-	int64 sl_time;
-	int64 jac_time;
-	int64 sc_time;
-	int64 pp_time;
+	void SetMotionPrediction(bool enable) { motion_prediction = enable; }
+	bool GetMotionPrediction() const { return motion_prediction; }
+
+	StageTimer& GetStageTimer() { return timer; }
+
+	// stage times of the last frame in microseconds
+	int64 render_time;	// rendering and readback
+	int64 sl_time;		// search lines and bundle probabilities
+	int64 jac_time;		// jacobian and solve
+	int64 sc_time;		// matching
+	int64 pp_time;		// histogram update
+
+	int iter_count;
 
 protected:
 	virtual void Track(std::vector<cv::Mat>& imagePyramid, std::vector<Object3D*>& objects, int runs = 1) = 0;
 
 	void CheckPose(std::vector<Object3D*>& objects);
+	void PredictPoses(std::vector<Object3D*>& objects);
+	// marks the objects whose tracking quality fell below their threshold as lost and the recovered ones as tracked
+	void UpdateTrackingLoss(std::vector<Object3D*>& objects);
+	void UpdateStageTimes();
 
 	cv::Rect Compute2DROI(Object3D* object, const cv::Size& maxSize, int offset);
 	cv::Rect computeBoundingBox(const std::vector<cv::Point3i>& centersIDs, int offset, int level, const cv::Size& maxSize);
@@ -53,6 +70,14 @@ protected:
 	cv::Mat map2;
 
 	bool initialized;
+
+	bool motion_prediction;
+	float motion_damping;
+
+	bool loss_detection;
+
+	StageTimer timer;
+	int frame_count;
 };
 
 class Histogram;
@@ -81,6 +106,16 @@ public:
 	void GetBundleProb(const cv::Mat& frame, int oid);
 	void FilterOccludedPoint(const cv::Mat& mask, const cv::Mat& depth);
 
+	/**
+	 *  Estimates the tracking quality from the matched search lines of one object.
+	 *  A line with a matched edge scores the mean foreground posterior on its inner
+	 *  side minus the one on its outer side, mapped from [-1, 1] to [0, 1], an
+	 *  active line without an edge scores 0.5 like a random segmentation.
+	 *
+	 *  @return The mean score of the active search lines, negative without any.
+	 */
+	float ComputeQuality() const;
+
 protected:
 	std::shared_ptr<SearchLine> search_line;
 	std::vector<float> scores;
@@ -1,4 +1,5 @@
 #include <fstream>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
@@ -9,8 +10,10 @@
 
 #include "m_func.h"
 #include "histogram.h"
+#include "global_params.h"
 #include "search_line.h"
 #include "tracker_slc.h"
+#include "transformations.h"
 
 //#define COLOR_MATCHING
 //#define USE_MIXED_OPTIMIZE
@@ -22,7 +25,6 @@
 //#define SHOW_SLC_CONTOUR_POINTS
 //#define SHOW_SLC_MODELLED_OCCLUSION
 //#define SHOW_SLC_SEARCH_LINE_WEIGHT
-//#define SHOW_RUNTIME
 
 enum {
 	RUN_TRACK = 0,
@@ -32,7 +34,22 @@ enum {
 SLCTracker::SLCTracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vector<Object3D*>& objects)
 	: SLTracker(K, distCoeffs, objects)
 {
-
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+	early_termination = gp->earlyTermination != 0;
+	skip_all = gp->convergenceSkipAll != 0;
+	conv_rot = gp->convergenceRotation;
+	conv_trans = gp->convergenceTranslation;
+	conv_lines = gp->convergenceActiveLines;
+
+	adaptive_iterations = gp->adaptiveIterations != 0;
+	confident_quality = gp->confidentQuality;
+	doubtful_quality = gp->doubtfulQuality;
+
+	contour_reuse = gp->contourReuse != 0;
+	reuse_rot = gp->contourReuseRotation;
+	reuse_trans = gp->contourReuseTranslation;
+
+	num_initialized = 0;
 }
 
 void SLCTracker::PreProcess(cv::Mat frame) {
@@ -40,22 +57,172 @@ void SLCTracker::PreProcess(cv::Mat frame) {
 }
 
 void SLCTracker::Track(std::vector<cv::Mat>& imagePyramid, std::vector<Object3D*>& objects, int runs) {
+	iter_count = 0;
+	bool done = false;
+
+	float scale = IterationScale(objects);
+	auto iterations = [scale, runs](int base) { return std::max(1, cvRound(base * runs * scale)); };
+
+	// objects that are not iterated in this frame keep no estimate
+	for (auto object : objects) {
+		object->setTrackingQuality(-1.0f);
+	}
+
+	contour_cache.assign(objects.size(), ContourCache());
+
+	ResetConvergence((int)objects.size());
 #ifdef SHOW_SLC_DEBUG
 	RunIteration(objects, imagePyramid, 2, 12, 2, 8.0f, 1.2f);
 	RunIteration(objects, imagePyramid, 0, 12, 2, 8.0f, 1.2f, RUN_DEBUG);
-	for (int iter = 0; iter < runs * 3; iter++) {
+	for (int iter = 0; iter < iterations(3) && !done; iter++) {
 #else
-	for (int iter = 0; iter < runs * 4; iter++) {
+	for (int iter = 0; iter < iterations(4) && !done; iter++) {
 #endif
-		RunIteration(objects, imagePyramid, 2, 12, 2, 8.0f, 1.2f, 0.2f);
+		done = RunIteration(objects, imagePyramid, 2, 12, 2, 8.0f, 1.2f, 0.2f);
 	}
 
-	for (int iter = 0; iter < runs * 2; iter++) {
-		RunIteration(objects, imagePyramid, 1, 10, 2, 6.0f, 1.0f, 0.2f);
+	if (done && skip_all)
+		return;
+
+	done = false;
+	ResetConvergence((int)objects.size());
+	for (int iter = 0; iter < iterations(2) && !done; iter++) {
+		done = RunIteration(objects, imagePyramid, 1, 10, 2, 6.0f, 1.0f, 0.2f);
 	}
 
-	for (int iter = 0; iter < runs * 1; iter++) {
-		RunIteration(objects, imagePyramid, 0, 8, 2, 4.0f, 0.8f, 0.2f);
+	if (done && skip_all)
+		return;
+
+	done = false;
+	ResetConvergence((int)objects.size());
+	for (int iter = 0; iter < iterations(1) && !done; iter++) {
+		done = RunIteration(objects, imagePyramid, 0, 8, 2, 4.0f, 0.8f, 0.2f);
+	}
+}
+
+float SLCTracker::IterationScale(const std::vector<Object3D*>& objects) const {
+	if (!adaptive_iterations)
+		return 1.0f;
+
+	float quality = -1.0f;
+	for (auto object : objects) {
+		if (!object->isInitialized() || object->getTrackingQuality() < 0.0f)
+			continue;
+
+		if (quality < 0.0f || object->getTrackingQuality() < quality)
+			quality = object->getTrackingQuality();
+	}
+
+	if (quality < 0.0f)
+		return 1.0f;
+	if (quality >= confident_quality)
+		return 0.5f;
+	if (quality < doubtful_quality)
+		return 2.0f;
+	return 1.0f;
+}
+
+void SLCTracker::ResetConvergence(int num_objects) {
+	converged.assign(num_objects, 0);
+	active_lines.assign(num_objects, -1);
+}
+
+bool SLCTracker::IsConverged(const cv::Matx61f& xi, int num_active, int pre_active) const {
+	if (!early_termination || pre_active < 0)
+		return false;
+
+	float rot = sqrt(xi(0) * xi(0) + xi(1) * xi(1) + xi(2) * xi(2));
+	float trans = sqrt(xi(3) * xi(3) + xi(4) * xi(4) + xi(5) * xi(5));
+	float lines = fabs(float(num_active - pre_active)) / std::max(pre_active, 1);
+
+	return rot < conv_rot && trans < conv_trans && lines <= conv_lines;
+}
+
+bool SLCTracker::CanReuseContour(int oid, int level, const cv::Matx44f& T_cm) const {
+	if (!contour_reuse || oid >= contour_cache.size())
+		return false;
+
+	const ContourCache& cache = contour_cache[oid];
+	if (cache.level != level || cache.points.empty())
+		return false;
+
+	// accumulated pose change since the contour has been rendered
+	cv::Matx61f xi = Transformations::log(T_cm * cache.T_ref.inv());
+	float rot = sqrt(xi(0) * xi(0) + xi(1) * xi(1) + xi(2) * xi(2));
+	float trans = sqrt(xi(3) * xi(3) + xi(4) * xi(4) + xi(5) * xi(5));
+
+	return rot < reuse_rot && trans < reuse_trans;
+}
+
+void SLCTracker::CacheContour(int oid, int level, const cv::Matx44f& T_cm, const cv::Mat& masks_map, const cv::Mat& depth_map, int m_id) {
+	if (oid >= contour_cache.size())
+		contour_cache.resize(oid + 1);
+
+	ContourCache& cache = contour_cache[oid];
+	cache.level = level;
+	cache.T_ref = T_cm;
+	cache.points.clear();
+	cache.normals.clear();
+
+	const std::vector<std::vector<cv::Point> >& search_points = search_line->search_points;
+	std::vector<cv::Point> centers;
+	std::vector<cv::Point2f> norms;
+	for (int r = 0; r < search_points.size(); r++) {
+		if (!search_line->actives[r])
+			continue;
+
+		int mid = search_points[r][search_points[r].size() - 1].x;
+		cv::Point center = search_points[r][mid];
+
+		// the depth of a center covered by another object belongs to that object
+		if (m_id > 0 && masks_map.at<uchar>(center) != m_id)
+			continue;
+
+		centers.push_back(center);
+		norms.push_back(search_line->norms[r]);
+	}
+
+	std::vector<cv::Point3f> pts3d;
+	view->BackProjectPoints(centers, depth_map, cache.T_ref, pts3d);
+
+	cv::Matx33f R_t = cache.T_ref.get_minor<3, 3>(0, 0).t();
+	for (int i = 0; i < pts3d.size(); i++) {
+		cache.points.push_back(cv::Vec3f(pts3d[i].x, pts3d[i].y, pts3d[i].z));
+		cache.normals.push_back(R_t * cv::Vec3f(norms[i].x, norms[i].y, 0.0f));
+	}
+}
+
+void SLCTracker::ProjectContourPoints(const cv::Matx44f& T_cm, const std::vector<cv::Vec3f>& points, const std::vector<cv::Vec3f>& normals, std::vector<cv::Point2f>& points2d, std::vector<cv::Point2f>& normals2d, std::vector<cv::Vec3f>& points3d) {
+	points2d.clear();
+	normals2d.clear();
+	points3d.clear();
+
+	cv::Matx33f K = view->GetCalibrationMatrix().get_minor<3, 3>(0, 0);
+	float fx = K(0, 0);
+	float fy = K(1, 1);
+	float cx = K(0, 2);
+	float cy = K(1, 2);
+
+	cv::Matx33f R = T_cm.get_minor<3, 3>(0, 0);
+	cv::Vec3f t(T_cm(0, 3), T_cm(1, 3), T_cm(2, 3));
+
+	for (int i = 0; i < points.size(); i++) {
+		cv::Vec3f X = R * points[i] + t;
+		if (X[2] <= 0.0f)
+			continue;
+
+		cv::Vec3f N = R * normals[i];
+
+		// image direction of the normal, i.e. the projection jacobian applied to it
+		float nx = fx * (N[0] - X[0] * N[2] / X[2]) / X[2];
+		float ny = fy * (N[1] - X[1] * N[2] / X[2]) / X[2];
+		float nl = sqrt(nx * nx + ny * ny);
+		if (nl < 1e-6f)
+			continue;
+
+		points2d.push_back(cv::Point2f(fx * X[0] / X[2] + cx, fy * X[1] / X[2] + cy));
+		normals2d.push_back(cv::Point2f(nx / nl, ny / nl));
+		points3d.push_back(X);
 	}
 }
 
@@ -232,6 +399,93 @@ void SLCTracker::ComputeJac(
 	}
 }
 
+void SLCTracker::ComputeJac(const std::vector<cv::Vec3f>& points, cv::Matx66f& wJTJM, cv::Matx61f& JTM, float band_width, float ss) {
+	const std::vector<std::vector<cv::Point> >& search_points = search_line->search_points;
+	const std::vector<std::vector<cv::Point2f> >& bundle_prob = search_line->bundle_prob;
+	const std::vector<int>& point_ids = search_line->point_ids;
+
+	JTM = cv::Matx61f::zeros();
+	wJTJM = cv::Matx66f::zeros();
+	float* JT = JTM.val;
+	float* wJTJ = wJTJM.val;
+
+	cv::Matx33f K = view->GetCalibrationMatrix().get_minor<3, 3>(0, 0);
+	float fx = K(0, 0);
+	float fy = K(1, 1);
+
+	for (int r = 0; r < search_points.size(); r++) {
+		if (!search_line->actives[r])
+			continue;
+
+		int mid = search_points[r][search_points[r].size() - 1].x;
+		int eid = search_points[r][search_points[r].size() - 1].y;
+
+		float nx = search_line->norms[r].x;
+		float ny = search_line->norms[r].y;
+
+		float lambda1 = -1.2f;
+		float we = eid < 0 ? 0.1f : ColorWeight(lambda1, scores[r]);
+
+		// the exact 3D contour point replaces the lookup in the rendered front and back depth
+		const cv::Vec3f& X = points[point_ids[r]];
+		float Xc = X[0];
+		float Yc = X[1];
+		float Zc = X[2];
+		float Zc2 = Zc * Zc;
+
+		float J[6];
+		J[0] = nx * (-Xc*fx*Yc/Zc2) +     ny * (-fy -Yc*Yc*fy/Zc2);
+		J[1] = nx * (fx + Xc*Xc*fx/Zc2) + ny * (Xc*Yc*fy/Zc2);
+		J[2] = nx * (-fx*Yc/Zc)+          ny * (Xc*fy/Zc);
+		J[3] = nx * (fx/Zc);
+		J[4] =                            ny * (fy/Zc);
+		J[5] = nx * (-Xc*fx/Zc2) +        ny * (-Yc*fy/Zc2);
+
+		for (int c = 0; c < search_points[r].size() - 1; c++) {
+			float pyf = bundle_prob[r][c].x;
+			float pyb = bundle_prob[r][c].y;
+			if (eid > 0 && (c < eid && pyb < pyf || c > eid && pyf < pyb))
+				continue;
+
+			float dist = GetDistance(search_points[r][c], search_points[r][mid]);
+			if (dist > band_width)
+				continue;
+
+			if (c > mid)
+				dist = -dist;
+
+			float lambda2 = -0.25f;
+			float wd = eid < 0 ? DistanceWeight(lambda2, 8.0f) : DistanceWeight(lambda2, GetDistance(search_points[r][c], search_points[r][eid]));
+
+			float wa = we * wd;
+
+			float s = ss;
+			float s2 = s * s;
+			float heaviside = 1.0f / float(CV_PI) * (-atan(dist * s)) + 0.5f;
+			float dirac = (1.0f / float(CV_PI)) * (s / (dist * s2 * dist + 1.0f));
+			float e = heaviside * (pyf - pyb) + pyb + 0.000001;
+			float DlogeDe = -(pyf - pyb) / e;
+			float constant_deriv = DlogeDe * dirac;
+			float c2 = constant_deriv * constant_deriv;
+			float w = -1.0f / log(e) * wa;
+
+			for (int n = 0; n < 6; n++) {
+				JT[n] += constant_deriv * J[n] * wa;
+			}
+
+			for (int n = 0; n < 6; n++)
+			for (int m = n; m < 6; m++) {
+				wJTJ[n * 6 + m] += w * J[n] * c2 * J[m];
+			}
+		}
+	}
+
+	for (int i = 0; i < wJTJM.rows; i++)
+	for (int j = i + 1; j < wJTJM.cols; j++) {
+		wJTJM(j, i) = wJTJM(i, j);
+	}
+}
+
 #if 1
 void SLCTracker::FindMatchPoint(float diff) {
 	std::vector<std::vector<cv::Point> >& search_points = search_line->search_points;
@@ -376,16 +630,30 @@ static void ConvertMask(const cv::Mat& src_mask, cv::Mat& mask, uchar oid) {
 	}
 }
 
-void SLCTracker::RunIteration(std::vector<Object3D*>& objects, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, int run_type) {
+bool SLCTracker::RunIteration(std::vector<Object3D*>& objects, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, int run_type) {
+	if (converged.size() != objects.size())
+		ResetConvergence((int)objects.size());
+
+	int numPending = 0;
+	for (int o = 0; o < objects.size(); o++) {
+		if (objects[o]->isInitialized() && !converged[o])
+			numPending++;
+	}
+	if (0 == numPending)
+		return true;
+
+	iter_count++;
+	timer.BeginIteration(level);
+
 	int width = view->GetWidth();
 	int height = view->GetHeight();
 	view->setLevel(level);
-	int numInitialized = 0;
+	num_initialized = 0;
 	for (int o = 0; o < objects.size(); o++) {
 		if (!objects[o]->isInitialized())
 			continue;
 
-		numInitialized++;
+		num_initialized++;
 
 		cv::Rect roi = Compute2DROI(objects[o], cv::Size(width / pow(2, level), height / pow(2, level)), 8);
 		if (roi.area() == 0)
@@ -399,46 +667,129 @@ void SLCTracker::RunIteration(std::vector<Object3D*>& objects, const std::vector
 	}
 
 	view->setLevel(level);
-	view->RenderSilhouette(std::vector<Model*>(objects.begin(), objects.end()), GL_FILL);
-	cv::Mat depth_map = view->DownloadFrame(View::DEPTH);
 
-	cv::Mat masks_map;
-	if (numInitialized > 1) {
-		masks_map = view->DownloadFrame(View::MASK);
-	}	else {
-		masks_map = depth_map;
-	}
+	PrepareIteration(objects, level);
 
+	bool all_converged = true;
 	for (int o = 0; o < objects.size(); o++) {
-		if (!objects[o]->isInitialized())
+		if (!objects[o]->isInitialized() || converged[o])
 			continue;
 
 		cv::Rect roi = Compute2DROI(objects[o], cv::Size(width / pow(2, level), height / pow(2, level)), 8);
-		if (roi.area() == 0)
+		if (roi.area() == 0) {
+			// nothing left to optimize for an object outside of the frame
+			converged[o] = 1;
 			continue;
+		}
 
-		int m_id = (numInitialized <= 1) ? -1 : objects[o]->getModelID();
-		cv::Mat mask_map;
-		ConvertMask(masks_map, m_id, mask_map);
+		cv::Matx66f wJTJ;
+		cv::Matx61f JT;
+		if (!ComputeIterationJac(o, imagePyramid, level, sl_len, sl_seg, band_width, ss, wJTJ, JT)) {
+			converged[o] = 1;
+			continue;
+		}
 
-		search_line->FindSearchLine(mask_map, imagePyramid[level], sl_len, sl_seg, true);
+		all_converged &= UpdatePose(o, wJTJ, JT);
+	}
+
+	return all_converged;
+}
+
+void SLCTracker::PrepareIteration(std::vector<Object3D*>& objects, int level) {
+	// the silhouette is only rendered if any object cannot reproject its cached contour
+	reuse_contour.assign(objects.size(), 0);
+	bool render = false;
+	for (int o = 0; o < objects.size(); o++) {
+		if (!objects[o]->isInitialized() || converged[o])
+			continue;
+
+		reuse_contour[o] = CanReuseContour(o, level, objects[o]->getPose());
+		render |= !reuse_contour[o];
+	}
 
-		if (numInitialized > 1) {
-			FilterOccludedPoint(masks_map, depth_map);
+	iter_depth_map.release();
+	iter_masks_map.release();
+	if (render) {
+		{
+			StageTimer::Scope scope(timer, StageTimer::RENDER);
+			view->RenderSilhouette(std::vector<Model*>(objects.begin(), objects.end()), GL_FILL);
 		}
 
-		GetBundleProb(imagePyramid[level], o);
+		StageTimer::Scope scope(timer, StageTimer::READBACK);
+		iter_depth_map = view->DownloadFrame(View::DEPTH);
 
-		FindMatchPoint(0.5);
+		if (num_initialized > 1) {
+			iter_masks_map = view->DownloadFrame(View::MASK);
+		}	else {
+			iter_masks_map = iter_depth_map;
+		}
+	}
+}
 
-		view->RenderSilhouette(objects[o], GL_FILL, true);
-		cv::Mat depth_inv_map = view->DownloadFrame(View::DEPTH);
+bool SLCTracker::ComputeIterationJac(int oid, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, cv::Matx66f& wJTJ, cv::Matx61f& JT) {
+	if (reuse_contour[oid]) {
+		// reproject the contour points back-projected in the last rendered iteration
+		std::vector<cv::Point2f> points2d;
+		std::vector<cv::Point2f> normals2d;
+		std::vector<cv::Vec3f> points3d;
+		{
+			StageTimer::Scope scope(timer, StageTimer::SEARCH_LINE);
+			const ContourCache& cache = contour_cache[oid];
+			ProjectContourPoints(objects[oid]->getPose(), cache.points, cache.normals, points2d, normals2d, points3d);
+			search_line->FindSearchLine(points2d, normals2d, imagePyramid[level], sl_len);
+		}
 
-		cv::Matx66f wJTJ;
-		cv::Matx61f JT;
-		ComputeJac(objects[o], m_id, imagePyramid[level], mask_map, masks_map, depth_map, depth_inv_map, wJTJ, JT, band_width, ss);
+		if (search_line->search_points.empty())
+			return false;
+
+		{ StageTimer::Scope scope(timer, StageTimer::BUNDLE); GetBundleProb(imagePyramid[level], oid); }
+		{ StageTimer::Scope scope(timer, StageTimer::MATCH); FindMatchPoint(0.5); }
+		{ StageTimer::Scope scope(timer, StageTimer::JACOBIAN); ComputeJac(points3d, wJTJ, JT, band_width, ss); }
+		return true;
+	}
+
+	int m_id = (num_initialized <= 1) ? -1 : objects[oid]->getModelID();
+	cv::Mat mask_map;
+	{
+		StageTimer::Scope scope(timer, StageTimer::SEARCH_LINE);
+		ConvertMask(iter_masks_map, m_id, mask_map);
+
+		search_line->FindSearchLine(mask_map, imagePyramid[level], sl_len, sl_seg, true);
+
+		if (num_initialized > 1) {
+			FilterOccludedPoint(iter_masks_map, iter_depth_map);
+		}
+
+		if (contour_reuse) {
+			CacheContour(oid, level, objects[oid]->getPose(), iter_masks_map, iter_depth_map, m_id);
+		}
+	}
+
+	{ StageTimer::Scope scope(timer, StageTimer::BUNDLE); GetBundleProb(imagePyramid[level], oid); }
+	{ StageTimer::Scope scope(timer, StageTimer::MATCH); FindMatchPoint(0.5); }
+	{ StageTimer::Scope scope(timer, StageTimer::RENDER); view->RenderSilhouette(objects[oid], GL_FILL, true); }
 
-		cv::Matx44f T_cm = Transformations::exp(-wJTJ.inv(cv::DECOMP_CHOLESKY) * JT) * objects[o]->getPose();
-		objects[o]->setPose(T_cm);
+	cv::Mat depth_inv_map;
+	{ StageTimer::Scope scope(timer, StageTimer::READBACK); depth_inv_map = view->DownloadFrame(View::DEPTH); }
+	{ StageTimer::Scope scope(timer, StageTimer::JACOBIAN); ComputeJac(objects[oid], m_id, imagePyramid[level], mask_map, iter_masks_map, iter_depth_map, depth_inv_map, wJTJ, JT, band_width, ss); }
+	return true;
+}
+
+bool SLCTracker::UpdatePose(int oid, const cv::Matx66f& wJTJ, const cv::Matx61f& JT) {
+	cv::Matx61f xi;
+	{
+		StageTimer::Scope scope(timer, StageTimer::SOLVE);
+		xi = -wJTJ.inv(cv::DECOMP_CHOLESKY) * JT;
+		cv::Matx44f T_cm = Transformations::exp(xi) * objects[oid]->getPose();
+		objects[oid]->setPose(T_cm);
 	}
+
+	int num_active = (int)std::count(search_line->actives.begin(), search_line->actives.end(), 1);
+	converged[oid] = IsConverged(xi, num_active, active_lines[oid]);
+	active_lines[oid] = num_active;
+
+	// the last iteration of the frame leaves its estimate
+	objects[oid]->setTrackingQuality(ComputeQuality());
+
+	return converged[oid] != 0;
 }
\ No newline at end of file
@@ -10,9 +10,78 @@ public:
 
 protected:
 	virtual void Track(std::vector<cv::Mat>& imagePyramid, std::vector<Object3D*>& objects, int runs = 1) override;
-	void RunIteration(std::vector<Object3D*>& objects, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, int run_type = 0);
+	virtual bool RunIteration(std::vector<Object3D*>& objects, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, int run_type = 0);
+
+	/**
+	 *  Prepares the data all objects of an iteration share, after its pyramid level has been
+	 *  chosen. Renders the silhouettes unless every object can reproject its cached contour.
+	 */
+	virtual void PrepareIteration(std::vector<Object3D*>& objects, int level);
+
+	/**
+	 *  Finds the search lines of an object in the current iteration and assembles its
+	 *  normal equations.
+	 *
+	 *  @return Whether the object has any search line, otherwise it is left as converged.
+	 */
+	virtual bool ComputeIterationJac(int oid, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, cv::Matx66f& wJTJ, cv::Matx61f& JT);
+
+	/**
+	 *  Applies the Gauss-Newton step of the normal equations to the pose of an object and
+	 *  updates its convergence state and tracking quality.
+	 *
+	 *  @return Whether the object converged.
+	 */
+	bool UpdatePose(int oid, const cv::Matx66f& wJTJ, const cv::Matx61f& JT);
 	void ComputeJac(Object3D* object, int m_id, const cv::Mat& frame,  const cv::Mat& mask_map, const cv::Mat& masks_map, const cv::Mat& depth_map, const cv::Mat& depth_inv_map, cv::Matx66f& wJTJM, cv::Matx61f& JTM, float band_width, float ss);
+	// contour points given in camera coordinates, indexed by the point ids of the search lines
+	void ComputeJac(const std::vector<cv::Vec3f>& points, cv::Matx66f& wJTJM, cv::Matx61f& JTM, float band_width, float ss);
 	void FindMatchPoint(float diff);
 	void FindMatchPointMaxConv(SearchLine* search_line, float diff);
 	virtual void PreProcess(cv::Mat frame);
-};
\ No newline at end of file
+
+	void ResetConvergence(int num_objects);
+	bool IsConverged(const cv::Matx61f& xi, int num_active, int pre_active) const;
+
+	// scale of the iterations per level from the worst tracking quality of the last frame
+	float IterationScale(const std::vector<Object3D*>& objects) const;
+
+	bool CanReuseContour(int oid, int level, const cv::Matx44f& T_cm) const;
+	// m_id is the object's id in masks_map, -1 for a single object without occlusions
+	void CacheContour(int oid, int level, const cv::Matx44f& T_cm, const cv::Mat& masks_map, const cv::Mat& depth_map, int m_id);
+	void ProjectContourPoints(const cv::Matx44f& T_cm, const std::vector<cv::Vec3f>& points, const std::vector<cv::Vec3f>& normals, std::vector<cv::Point2f>& points2d, std::vector<cv::Point2f>& normals2d, std::vector<cv::Vec3f>& points3d);
+
+protected:
+	// per object convergence state of the current pyramid level
+	std::vector<uchar> converged;
+	std::vector<int> active_lines;
+
+	bool early_termination;
+	bool skip_all;
+	float conv_rot;
+	float conv_trans;
+	float conv_lines;
+
+	bool adaptive_iterations;
+	float confident_quality;
+	float doubtful_quality;
+
+	// back-projected contour points of the last rendered iteration per object
+	struct ContourCache {
+		int level = -1;
+		cv::Matx44f T_ref;
+		std::vector<cv::Vec3f> points;
+		std::vector<cv::Vec3f> normals;
+	};
+	std::vector<ContourCache> contour_cache;
+
+	bool contour_reuse;
+	float reuse_rot;
+	float reuse_trans;
+
+	// state of the current iteration: the rendered maps and which objects reproject their cached contour
+	int num_initialized;
+	cv::Mat iter_depth_map;
+	cv::Mat iter_masks_map;
+	std::vector<uchar> reuse_contour;
+};
@@ -0,0 +1,83 @@
+#include <map>
+
+#include <glog/logging.h>
+
+#include "view.h"
+#include "global_params.h"
+#include "tracker_sparse_slc.h"
+
+SparseSLCTracker::SparseSLCTracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vector<Object3D*>& objects)
+	: SLCTracker(K, distCoeffs, objects)
+{
+	OT3D::GlobalParam* gp = OT3D::GlobalParam::Instance();
+
+	// instances of the same part share one contour model
+	std::map<const ModelAsset*, std::shared_ptr<ContourModel> > shared;
+
+	for (auto object : objects) {
+		std::shared_ptr<ContourModel>& contour_model = shared[object->getAsset().get()];
+		if (contour_model) {
+			contour_models.push_back(contour_model);
+			continue;
+		}
+
+		contour_model = std::make_shared<ContourModel>();
+		std::string file = ContourModelFile(object);
+
+		// rebuild when the file is missing, invalid or was built for another mesh or with other settings
+		unsigned long long meshHash = object->getAsset()->getMeshHash();
+		if (!contour_model->Load(file, meshHash) ||
+			contour_model->GetSubdivisions() != gp->contourSubdivisions ||
+			contour_model->GetNumPoints() != gp->contourPoints) {
+			LOG(INFO) << "Building contour model " << file;
+			if (!contour_model->Build(object, gp->contourSubdivisions, gp->contourPoints))
+				LOG(WARNING) << "No contour found for some viewpoints of " << object->getModelFilename();
+			if (!contour_model->Save(file, meshHash))
+				LOG(WARNING) << "Cannot write contour model " << file;
+		}
+
+		contour_models.push_back(contour_model);
+	}
+}
+
+std::string SparseSLCTracker::ContourModelFile(Object3D* object) {
+	return object->getModelFilename() + ".contours";
+}
+
+void SparseSLCTracker::ProjectContour(int oid, std::vector<cv::Point2f>& points2d, std::vector<cv::Point2f>& normals2d, std::vector<cv::Vec3f>& points3d) {
+	points2d.clear();
+	normals2d.clear();
+	points3d.clear();
+
+	const ContourModel& contour_model = *contour_models[oid];
+	cv::Matx44f T_cm = objects[oid]->getPose();
+	int vid = contour_model.GetNearestView(T_cm);
+	if (vid < 0)
+		return;
+
+	const ContourModel::ContourView& contour_view = contour_model.GetView(vid);
+	ProjectContourPoints(T_cm, contour_view.points, contour_view.normals, points2d, normals2d, points3d);
+}
+
+void SparseSLCTracker::PrepareIteration(std::vector<Object3D*>& objects, int level) {
+	// the contour model replaces the silhouette rendering
+}
+
+bool SparseSLCTracker::ComputeIterationJac(int oid, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, cv::Matx66f& wJTJ, cv::Matx61f& JT) {
+	std::vector<cv::Point2f> points2d;
+	std::vector<cv::Point2f> normals2d;
+	std::vector<cv::Vec3f> points3d;
+	{
+		StageTimer::Scope scope(timer, StageTimer::SEARCH_LINE);
+		ProjectContour(oid, points2d, normals2d, points3d);
+		search_line->FindSearchLine(points2d, normals2d, imagePyramid[level], sl_len);
+	}
+
+	if (search_line->search_points.empty())
+		return false;
+
+	{ StageTimer::Scope scope(timer, StageTimer::BUNDLE); GetBundleProb(imagePyramid[level], oid); }
+	{ StageTimer::Scope scope(timer, StageTimer::MATCH); FindMatchPoint(0.5); }
+	{ StageTimer::Scope scope(timer, StageTimer::JACOBIAN); ComputeJac(points3d, wJTJ, JT, band_width, ss); }
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include "tracker_slc.h"
+#include "contour_model.h"
+
+/**
+ *  SLC tracker variant that projects the precomputed contour points of the closest
+ *  viewpoint of a sparse-viewpoint contour model instead of rendering the silhouette
+ *  and the depth maps in every iteration. Rendering only happens for the histogram
+ *  update once per frame. Occlusions between objects are not modelled.
+ */
+class SparseSLCTracker : public SLCTracker {
+public:
+	SparseSLCTracker(const cv::Matx33f& K, const cv::Matx14f& distCoeffs, std::vector<Object3D*>& objects);
+
+protected:
+	virtual void PrepareIteration(std::vector<Object3D*>& objects, int level) override;
+	virtual bool ComputeIterationJac(int oid, const std::vector<cv::Mat>& imagePyramid, int level, int sl_len, int sl_seg, float band_width, float ss, cv::Matx66f& wJTJ, cv::Matx61f& JT) override;
+
+	/**
+	 *  Projects the contour points of the viewpoint closest to the current pose of an
+	 *  object at the current pyramid level.
+	 *
+	 *  @param  oid The index of the object.
+	 *  @param  points2d The projected contour points.
+	 *  @param  normals2d The projected outward unit contour normals.
+	 *  @param  points3d The contour points in camera coordinates.
+	 */
+	void ProjectContour(int oid, std::vector<cv::Point2f>& points2d, std::vector<cv::Point2f>& normals2d, std::vector<cv::Vec3f>& points3d);
+
+	static std::string ContourModelFile(Object3D* object);
+
+protected:
+	std::vector<std::shared_ptr<ContourModel> > contour_models;
+};
@@ -145,10 +145,12 @@ Matx44f Transformations::exp(Matx61f xi)
     // angle of the twist/rotation
     float theta = (float)norm(r);
     
-    // return the identity group element for theta == 0, as there is no motion
+    // for theta == 0 there is no rotation and the translation equals the velocity
     if(abs(theta) < FLT_EPSILON)
     {
-        return T;
+        T(0, 3) = v[0];
+        T(1, 3) = v[1];
+        T(2, 3) = v[2];
     }
     else
     {
@@ -177,3 +179,40 @@ Matx44f Transformations::exp(Matx61f xi)
     
     return T;
 }
+
+Matx61f Transformations::log(const Matx44f& T)
+{
+    Matx61f xi;
+    
+    Matx33f R(T(0, 0), T(0, 1), T(0, 2),
+              T(1, 0), T(1, 1), T(1, 2),
+              T(2, 0), T(2, 1), T(2, 2));
+    Vec3f t(T(0, 3), T(1, 3), T(2, 3));
+    
+    // rotational part of the twist coordinates as the matrix logarithm of R
+    Vec3f r;
+    Rodrigues(R, r);
+    
+    float theta = (float)norm(r);
+    
+    xi(0, 0) = r[0]; xi(1, 0) = r[1]; xi(2, 0) = r[2];
+    
+    // for a pure translation the twist velocity equals the translation vector
+    if(abs(theta) < FLT_EPSILON)
+    {
+        xi(3, 0) = t[0]; xi(4, 0) = t[1]; xi(5, 0) = t[2];
+        return xi;
+    }
+    
+    // invert t = ((I - R)*w_x + w*w^T*theta)*v/theta as used in exp()
+    Matx33f I = Matx33f::eye();
+    Vec3f w = r/theta;
+    Matx33f w_x = Transformations::axiator(w);
+    Matx33f A = (I - R)*w_x + w*w.t()*theta;
+    
+    Vec3f v = (A.inv()*t)*theta;
+    
+    xi(3, 0) = v[0]; xi(4, 0) = v[1]; xi(5, 0) = v[2];
+    
+    return xi;
+}
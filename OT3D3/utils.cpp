@@ -77,3 +77,26 @@ bool IsFileExist(const std::string& name)
     std::ifstream f(name.c_str());
     return f.good();
 }
+
+static void HashWords(unsigned long long& hash, const void* data, size_t size)
+{
+    // word-wise, the meshes can have millions of vertices
+    const unsigned int* words = (const unsigned int*)data;
+    for (size_t i = 0; i < size / sizeof(unsigned int); i++)
+    {
+        hash ^= words[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+unsigned long long HashMesh(const std::vector<cv::Vec3f>& vertices, const std::vector<unsigned int>& indices)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+
+    unsigned long long sizes[2] = { vertices.size(), indices.size() };
+    HashWords(hash, sizes, sizeof(sizes));
+    HashWords(hash, vertices.data(), vertices.size() * sizeof(cv::Vec3f));
+    HashWords(hash, indices.data(), indices.size() * sizeof(unsigned int));
+
+    return hash;
+}
@@ -15,4 +15,7 @@ bool readCameraParameters(const std::string filename, int& imgWidth, int& imgHei
 bool readInitialPose(const std::string filename, cv::Mat& initial_pose);
 bool readInitialPose(const std::string filename, cv::Matx44f& initial_pose);
 
-bool IsFileExist(const std::string& name);
\ No newline at end of file
+bool IsFileExist(const std::string& name);
+
+// 64 bit FNV-1a hash of the vertices and triangle indices of a mesh, which keys the files derived from it
+unsigned long long HashMesh(const std::vector<cv::Vec3f>& vertices, const std::vector<unsigned int>& indices);
\ No newline at end of file
@@ -1,8 +1,10 @@
+#include <cmath>
 #include <iostream>
 #include <glog/logging.h>
 #include <spdlog/spdlog.h>
 
 #include "view.h"
+#include "point_projector.h"
 
 using namespace cv;
 using namespace std;
@@ -97,6 +99,10 @@ Matx44f View::GetCalibrationMatrix() {
 	return calibrationMatrices[currentLevel];
 }
 
+Matx44f View::GetCalibrationMatrix(int level) {
+	return calibrationMatrices[level];
+}
+
 #include "shader/shaders.h"
 
 void View::init(const Matx33f& K, int width, int height, float zNear, float zFar, int numLevels) {
@@ -228,6 +234,10 @@ bool View::initShaderProgramFromCode(QOpenGLShaderProgram* program, char* vertex
 		return false;
 	}
 
+	// the vertex array objects of the models use fixed attribute locations
+	program->bindAttributeLocation("aPosition", ModelAsset::kPositionLocation);
+	program->bindAttributeLocation("aNormal", ModelAsset::kNormalLocation);
+
 	if (!program->link()) 
 	{
 		spdlog::error("Error linking shaders");
@@ -236,15 +246,9 @@ bool View::initShaderProgramFromCode(QOpenGLShaderProgram* program, char* vertex
 	return true;
 }
 
-void View::Project(const cv::Matx44f& mv_mat, std::vector<cv::Vec3f>& model_points, std::vector<cv::Vec2f>& image_points) {
-	for (int i = 0; i < model_points.size(); ++i) {
-		cv::Matx44f kmat = View::GetCalibrationMatrix();
-		cv::Vec4f ptv = kmat*mv_mat*cv::Vec4f(model_points[i](0), model_points[i](1), model_points[i](2), 1);
-
-		float dz = 1.0f/ptv(2);
-		image_points[i](0) = ptv(0)*dz;
-		image_points[i](1) = ptv(1)*dz;
-	}
+void View::Project(const cv::Matx44f& mv_mat, const std::vector<cv::Vec3f>& model_points, std::vector<cv::Vec2f>& image_points) {
+	PointProjector projector(GetCalibrationMatrix(), mv_mat);
+	projector.Project(model_points, image_points);
 }
 
 static bool PtInFrame(const cv::Vec2f& pt, int width, int height) {
@@ -252,8 +256,8 @@ static bool PtInFrame(const cv::Vec2f& pt, int width, int height) {
 }
 
 void View::RenderCV(Model* model, cv::Mat& frame, cv::Scalar color) {
-	std::vector<cv::Vec3f>& model_points = model->vertices;
-	std::vector<GLuint>& indices = model->indices;
+	const std::vector<cv::Vec3f>& model_points = model->getVertices();
+	const std::vector<GLuint>& indices = model->getIndices();
 
 	std::vector<cv::Vec2f> image_points(model_points.size());
 	Project(model->getPose(), model_points, image_points);
@@ -281,8 +285,8 @@ void View::RenderCV(Model* model, cv::Mat& frame, cv::Scalar color) {
 }
 
 void View::RenderCV(Model* model, cv::Mat& frame) {
-	std::vector<cv::Vec3f>& model_points = model->vertices;
-	std::vector<GLuint>& indices = model->indices;
+	const std::vector<cv::Vec3f>& model_points = model->getVertices();
+	const std::vector<GLuint>& indices = model->getIndices();
 
 	std::vector<cv::Vec2f> image_points(model_points.size());
 	Project(model->getPose(), model_points, image_points);
@@ -514,13 +518,15 @@ void View::ProjectBoundingBox(Model* model, std::vector<cv::Point2f>& projection
 	Point2f lt(FLT_MAX, FLT_MAX);
 	Point2f rb(-FLT_MAX, -FLT_MAX);
 
+	PointProjector projector(calibrationMatrices[currentLevel], pose * normalization);
+
 	for (int i = 0; i < points3D.size(); i++) {
-		Vec4f p = calibrationMatrices[currentLevel] * pose * normalization * points3D[i];
+		Vec2f p = projector.Project(Vec3f(points3D[i][0], points3D[i][1], points3D[i][2]));
 
-		if (p[2] == 0)
+		if (!std::isfinite(p[0]) || !std::isfinite(p[1]))
 			continue;
 
-		Point2f p2d = Point2f(p[0] / p[2], p[1] / p[2]);
+		Point2f p2d = Point2f(p[0], p[1]);
 		projections.push_back(p2d);
 
 		if (p2d.x < lt.x) lt.x = p2d.x;
@@ -564,13 +570,15 @@ void View::ProjectBoundingBox(Model* model, std::vector<cv::Point2f>& projection
 	Point2f lt(FLT_MAX, FLT_MAX);
 	Point2f rb(-FLT_MAX, -FLT_MAX);
 
+	PointProjector projector(calibrationMatrices[currentLevel], pose * normalization);
+
 	for (int i = 0; i < points3D.size(); i++) {
-		Vec4f p = calibrationMatrices[currentLevel] * pose * normalization * points3D[i];
+		Vec2f p = projector.Project(Vec3f(points3D[i][0], points3D[i][1], points3D[i][2]));
 
-		if (p[2] == 0)
+		if (!std::isfinite(p[0]) || !std::isfinite(p[1]))
 			continue;
 
-		Point2f p2d = Point2f(p[0] / p[2], p[1] / p[2]);
+		Point2f p2d = Point2f(p[0], p[1]);
 		projections.push_back(p2d);
 
 		if (p2d.x < lt.x) lt.x = p2d.x;
@@ -614,11 +622,13 @@ Mat View::DownloadFrame(View::FrameType type) {
 void View::ProjectPoints(const std::vector<cv::Point3f>& pts3d, const cv::Matx44f& pose, std::vector<cv::Point2f>& pts) {
 	pts.clear();
 
+	PointProjector projector(calibrationMatrices[currentLevel], pose);
+
 	for (int i = 0; i < pts3d.size(); i++) {
-		Vec4f p = calibrationMatrices[currentLevel] * pose * cv::Vec4f(pts3d[i].x, pts3d[i].y, pts3d[i].z, 1.0f);
+		Vec2f p = projector.Project(Vec3f(pts3d[i].x, pts3d[i].y, pts3d[i].z));
 
-		float x = p[0] / p[2];
-		float y = p[1] / p[2];
+		float x = p[0];
+		float y = p[1];
 
 		if (x >= 0 && x < width && y >= 0 && y < height) {
 			pts.push_back(cv::Point2f(x, y));
@@ -629,11 +639,13 @@ void View::ProjectPoints(const std::vector<cv::Point3f>& pts3d, const cv::Matx44
 void View::ProjectPoints(const std::vector<cv::Point3f>& pts3d, const cv::Matx44f& pose, std::vector<cv::Point>& pts) {
 	pts.clear();
 
+	PointProjector projector(calibrationMatrices[currentLevel], pose);
+
 	for (int i = 0; i < pts3d.size(); i++) {
-		Vec4f p = calibrationMatrices[currentLevel] * pose * cv::Vec4f(pts3d[i].x, pts3d[i].y, pts3d[i].z, 1.0f);
+		Vec2f p = projector.Project(Vec3f(pts3d[i].x, pts3d[i].y, pts3d[i].z));
 
-		float x = p[0] / p[2];
-		float y = p[1] / p[2];
+		float x = p[0];
+		float y = p[1];
 
 		if (x >= 0 && x < width && y >= 0 && y < height) {
 			pts.push_back(cv::Point(x, y));
@@ -643,10 +655,10 @@ void View::ProjectPoints(const std::vector<cv::Point3f>& pts3d, const cv::Matx44
 
 void View::BackProjectPoints(std::vector<cv::Point>& pts, const cv::Mat& depth_map, const cv::Matx44f& pose, std::vector<cv::Point3f>& pts3d) {
 	float* depthData = (float*)depth_map.ptr<float>();
-	cv::Matx44f k44 = GetCalibrationMatrix();
-	const cv::Matx33f& K = GetCalibrationMatrix().get_minor<3, 3>(0, 0);
-	float* K_invData = K.inv().val;
-	float* pdata = pose.inv().val;
+	cv::Matx33f K_inv = GetCalibrationMatrix().get_minor<3, 3>(0, 0).inv();
+	cv::Matx44f pose_inv = pose.inv();
+	const float* K_invData = K_inv.val;
+	const float* pdata = pose_inv.val;
 
 	pts3d.resize(pts.size());
 
@@ -51,8 +51,9 @@ public:
 	int GetWidth() { return fullWidth; }
 	int GetHeight() { return fullHeight; }
 	cv::Matx44f GetCalibrationMatrix();
+	cv::Matx44f GetCalibrationMatrix(int level);
 	
-	void Project(const cv::Matx44f& mv_mat, std::vector<cv::Vec3f>& model_points, std::vector<cv::Vec2f>& image_points);
+	void Project(const cv::Matx44f& mv_mat, const std::vector<cv::Vec3f>& model_points, std::vector<cv::Vec2f>& image_points);
 	void RenderCV(Model* model, cv::Mat& buf);
 	void RenderCV(Model* model, cv::Mat& buf, cv::Scalar color);
 